@@ -0,0 +1,154 @@
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: bench.c
+***
+***     Project: cocoOS
+***
+***************************************************************************************
+***************************************************************************************
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "bench.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define bench_cycles()	__rdtsc()
+#else
+#define bench_cycles()	0
+#endif
+
+
+static int json;
+static const char *filter;
+
+/* Per-op cost of each sample, filled by bench_stop() */
+static double nsSamples[ BENCH_MAX_SAMPLES ];
+static double cycleSamples[ BENCH_MAX_SAMPLES ];
+static uint32_t nSamples;
+
+
+static uint64_t bench_ns( void ) {
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+
+static int compare_double( const void *a, const void *b ) {
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return ( x > y ) - ( x < y );
+}
+
+
+/* Nearest rank percentile of a sorted array */
+static double percentile( const double *sorted, uint32_t n, uint32_t pct ) {
+	uint32_t rank = ( pct * n + 99 ) / 100;
+	return sorted[ rank ? rank - 1 : 0 ];
+}
+
+
+/* Parses the command line: [-j] [benchmark]. -j selects JSON lines instead
+of csv, a benchmark name restricts the run to that benchmark. */
+void bench_init( int argc, char *argv[] ) {
+	int i;
+	for ( i = 1; i < argc; ++i ) {
+		if ( strcmp( argv[ i ], "-j" ) == 0 ) {
+			json = 1;
+		}
+		else {
+			filter = argv[ i ];
+		}
+	}
+
+	if ( !json ) {
+		printf( "benchmark,param,samples,mean_ns,p50_ns,p90_ns,p99_ns,max_ns,p50_cycles,ops_per_sec\n" );
+		fflush( stdout );
+	}
+}
+
+
+int bench_selected( const char *name ) {
+	return ( filter == 0 ) || ( strcmp( filter, name ) == 0 );
+}
+
+
+void bench_start( bench_stamp *stamp ) {
+	stamp->cycles = bench_cycles();
+	stamp->ns = bench_ns();
+}
+
+
+/* Stores the cost of one op of the interval started by bench_start() */
+void bench_stop( bench_stamp *stamp, uint32_t ops ) {
+	uint64_t ns = bench_ns();
+	uint64_t cycles = bench_cycles();
+
+	if ( nSamples < BENCH_MAX_SAMPLES ) {
+		nsSamples[ nSamples ] = (double)( ns - stamp->ns ) / ops;
+		cycleSamples[ nSamples ] = (double)( cycles - stamp->cycles ) / ops;
+		++nSamples;
+	}
+}
+
+
+/* Prints the percentiles of the samples taken since the last report */
+void bench_report( const char *name, uint32_t param ) {
+	double mean = 0;
+	uint32_t i;
+
+	if ( nSamples == 0 ) {
+		return;
+	}
+
+	for ( i = 0; i != nSamples; ++i ) {
+		mean += nsSamples[ i ];
+	}
+	mean /= nSamples;
+
+	qsort( nsSamples, nSamples, sizeof( double ), compare_double );
+	qsort( cycleSamples, nSamples, sizeof( double ), compare_double );
+
+	printf( json ?
+		"{\"benchmark\":\"%s\",\"param\":%" PRIu32 ",\"samples\":%" PRIu32 ",\"mean_ns\":%.1f,"
+		"\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f,\"p50_cycles\":%.1f,\"ops_per_sec\":%.0f}\n" :
+		"%s,%" PRIu32 ",%" PRIu32 ",%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.0f\n",
+		name, param, nSamples, mean,
+		percentile( nsSamples, nSamples, 50 ),
+		percentile( nsSamples, nSamples, 90 ),
+		percentile( nsSamples, nSamples, 99 ),
+		nsSamples[ nSamples - 1 ],
+		percentile( cycleSamples, nSamples, 50 ),
+		mean > 0 ? 1e9 / mean : 0 );
+	fflush( stdout );
+
+	nSamples = 0;
+}
+
+
+/* Runs a benchmark in a child process. Semaphores, events and queues can not
+be deleted, so each run gets a fresh kernel this way. */
+void bench_run( benchproctype proc, uint32_t param ) {
+	int status;
+	pid_t pid = fork();
+
+	if ( pid == 0 ) {
+		proc( param );
+		exit( 0 );
+	}
+
+	if ( ( pid < 0 ) || ( waitpid( pid, &status, 0 ) < 0 ) || !WIFEXITED( status ) || WEXITSTATUS( status ) ) {
+		fprintf( stderr, "benchmark run failed, param %" PRIu32 "\n", param );
+	}
+}
@@ -0,0 +1,34 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/** @file bench.h Kernel benchmark helpers header file*/
+
+#include <inttypes.h>
+
+
+/* Ops timed together in one sample. Batching hides the cost of reading the
+clocks, which is in the same range as the fastest kernel paths. */
+#define BENCH_BATCH		64
+
+/* Upper limit of samples per benchmark run */
+#define BENCH_MAX_SAMPLES	4096
+
+
+typedef void (*benchproctype)( uint32_t param );
+
+/* One timed interval, taken with bench_start() and bench_stop() */
+typedef struct {
+	uint64_t ns;
+	uint64_t cycles;
+} bench_stamp;
+
+
+void bench_init( int argc, char *argv[] );
+int bench_selected( const char *name );
+void bench_start( bench_stamp *stamp );
+void bench_stop( bench_stamp *stamp, uint32_t ops );
+void bench_report( const char *name, uint32_t param );
+void bench_run( benchproctype proc, uint32_t param );
+
+
+#endif
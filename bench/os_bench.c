@@ -0,0 +1,469 @@
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_bench.c
+***
+***     Project: cocoOS
+***
+***************************************************************************************
+***************************************************************************************
+*/
+
+/* Kernel micro-benchmarks. Build on a Linux host with the interrupt free port,
+so that the numbers show the kernel paths and not the signal mask syscalls:
+
+    gcc -O2 -I. -DOS_PORT_NO_IRQ -DMAX_TASKS=254 bench/os_bench.c bench/bench.c os_*.c -o os_bench
+
+or with -DOS_TID_BITS=16 -DMAX_TASKS=65534 to sweep up to 65000 tasks. Add
+-DOS_TASK_SOA to compare the delta list kept apart from the TCBs.
+
+Each benchmark runs in its own process with a fresh kernel, os_tick() is
+called directly instead of from a timer. */
+
+#include <stdio.h>
+#include "cocoos.h"
+#include "bench.h"
+
+
+#define SAMPLES		1000
+
+/* Task counts swept by the scaling benchmarks, capped at MAX_TASKS */
+static const uint32_t taskCounts[] = { 1, 2, 8, 32, 64, 128, 254, 1024, 4000 };
+#define N_TASK_COUNTS	( sizeof( taskCounts ) / sizeof( taskCounts[ 0 ] ) )
+
+/* Armed timer counts swept by the timer benchmarks */
+static const uint32_t timerCounts[] = { 1, 64, 1024, 4096 };
+#define N_TIMER_COUNTS	( sizeof( timerCounts ) / sizeof( timerCounts[ 0 ] ) )
+#define MAX_TIMERS		4096
+
+/* Sleeping task counts swept by the delta list benchmark, capped at MAX_TASKS */
+static const uint32_t sleeperCounts[] = { 64, 1024, 4096, 16384, 65000 };
+#define N_SLEEPER_COUNTS	( sizeof( sleeperCounts ) / sizeof( sleeperCounts[ 0 ] ) )
+
+static bench_stamp stamp;
+static uint32_t count;
+static os_event_type *evPing;
+static os_sem_type *semPing;
+static os_sem_type *semPong;
+static os_timer_type timers[ MAX_TIMERS + 1 ];
+
+
+/* Task procedure of the tasks that are only there to fill the kernel lists */
+static int idle_taskproc( void ) {
+	return 0;
+}
+
+
+/* Creates n tasks that never run, the last one is ready, the others pending.
+The first one gets the highest priority. */
+static os_tid_t create_idle_tasks( uint32_t n ) {
+	os_tid_t tid = NO_TID;
+	uint32_t i;
+	for ( i = 0; i != n; ++i ) {
+		tid = os_task_create( idle_taskproc, (uint8_t)i );
+		if ( i + 1 != n ) {
+			os_task_pending_set( tid );
+		}
+	}
+	return tid;
+}
+
+
+/* OS_SCHEDULE yield: the cost of one trip through os_schedule() into a task
+that yields straight back */
+static int yield_task( void ) {
+	OS_BEGIN;
+	for (;;) {
+		OS_SCHEDULE;
+	}
+	OS_END;
+	return 0;
+}
+
+static void bench_yield( uint32_t param ) {
+	uint32_t i, j;
+	os_init();
+	os_task_create( yield_task, 0 );
+
+	for ( i = 0; i != SAMPLES; ++i ) {
+		bench_start( &stamp );
+		for ( j = 0; j != BENCH_BATCH; ++j ) {
+			os_schedule();
+		}
+		bench_stop( &stamp, BENCH_BATCH );
+	}
+	bench_report( "yield", param );
+}
+
+
+/* Resume of a task with 32 yield points, each os_schedule() continues at the
+next one. The name tells whether the kernel was built with the computed goto
+resume or the switch fallback (OS_RESUME_SWITCH). */
+#if defined( OS_RESUME_GOTO )
+#define RESUME_BENCH	"resume_goto"
+#else
+#define RESUME_BENCH	"resume_switch"
+#endif
+
+static int resume_task( void ) {
+	OS_BEGIN;
+	for (;;) {
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+		OS_SCHEDULE;
+	}
+	OS_END;
+	return 0;
+}
+
+static void bench_resume( uint32_t param ) {
+	uint32_t i, j;
+	os_init();
+	os_task_create( resume_task, 0 );
+
+	for ( i = 0; i != SAMPLES; ++i ) {
+		bench_start( &stamp );
+		for ( j = 0; j != BENCH_BATCH; ++j ) {
+			os_schedule();
+		}
+		bench_stop( &stamp, BENCH_BATCH );
+	}
+	bench_report( RESUME_BENCH, param );
+}
+
+
+/* Event latency: from OS_SIGNAL_EVENT in one task until the waiting task of
+higher priority resumes after its OS_WAIT_SINGLE_EVENT. Events are not latched,
+so the waiter must be back waiting before the next signal, hence its priority. */
+static int event_waiter_task( void ) {
+	OS_BEGIN;
+	for (;;) {
+		OS_WAIT_SINGLE_EVENT( evPing );
+		bench_stop( &stamp, 1 );
+		++count;
+	}
+	OS_END;
+	return 0;
+}
+
+static int event_signaler_task( void ) {
+	OS_BEGIN;
+	for (;;) {
+		bench_start( &stamp );
+		OS_SIGNAL_EVENT( evPing );
+	}
+	OS_END;
+	return 0;
+}
+
+static void bench_event_latency( uint32_t param ) {
+	os_init();
+	evPing = os_create_event();
+	os_task_create( event_waiter_task, 0 );
+	os_task_create( event_signaler_task, 1 );
+
+	while ( count != SAMPLES ) {
+		os_schedule();
+	}
+	bench_report( "event_latency", param );
+}
+
+
+/* Semaphore ping-pong: one round trip is two hand-offs between two tasks */
+static int sem_pong_task( void ) {
+	OS_BEGIN;
+	for (;;) {
+		OS_WAIT_SEM( semPing );
+		OS_SIGNAL_SEM( semPong );
+	}
+	OS_END;
+	return 0;
+}
+
+static int sem_ping_task( void ) {
+	OS_BEGIN;
+	for (;;) {
+		if ( ( count % BENCH_BATCH ) == 0 ) {
+			bench_start( &stamp );
+		}
+		OS_SIGNAL_SEM( semPing );
+		OS_WAIT_SEM( semPong );
+		if ( ( ++count % BENCH_BATCH ) == 0 ) {
+			bench_stop( &stamp, BENCH_BATCH );
+		}
+	}
+	OS_END;
+	return 0;
+}
+
+static void bench_sem_pingpong( uint32_t param ) {
+	os_init();
+	semPing = os_create_sem( 0 );
+	semPong = os_create_sem( 0 );
+	os_task_create( sem_pong_task, 0 );
+	os_task_create( sem_ping_task, 1 );
+
+	while ( count != SAMPLES * BENCH_BATCH ) {
+		os_schedule();
+	}
+	bench_report( "sem_pingpong", param );
+}
+
+
+/* os_tick() with param sleeping tasks of which none is due */
+static void bench_tick( uint32_t param ) {
+	uint32_t i, j;
+	os_init();
+	for ( i = 0; i != param; ++i ) {
+		os_task_wait_time_set( os_task_create( idle_taskproc, 0 ), (uint16_t)( 65000u - i ) );
+	}
+
+	for ( i = 0; i != SAMPLES / 4; ++i ) {
+		bench_start( &stamp );
+		for ( j = 0; j != BENCH_BATCH; ++j ) {
+			os_tick();
+		}
+		bench_stop( &stamp, BENCH_BATCH );
+	}
+	bench_report( "tick", param );
+}
+
+
+/* Selection of the task to run with param tasks, only the lowest prio is ready */
+static void bench_ready_select( uint32_t param ) {
+	uint32_t i, j;
+	volatile os_tid_t tid;
+	os_init();
+	create_idle_tasks( param );
+
+	for ( i = 0; i != SAMPLES; ++i ) {
+		bench_start( &stamp );
+		for ( j = 0; j != BENCH_BATCH; ++j ) {
+			tid = os_task_highest_prio_ready_task();
+		}
+		bench_stop( &stamp, BENCH_BATCH );
+	}
+	(void)tid;
+	bench_report( "ready_select", param );
+}
+
+
+/* Waiting for and signaling an event with param other tasks not waiting */
+static void bench_event_signal( uint32_t param ) {
+	uint32_t i, j;
+	os_tid_t tid;
+	os_init();
+	evPing = os_create_event();
+	tid = create_idle_tasks( param + 1 );
+
+	for ( i = 0; i != SAMPLES; ++i ) {
+		bench_start( &stamp );
+		for ( j = 0; j != BENCH_BATCH; ++j ) {
+			os_wait_event( tid, evPing, 1 );
+			os_signal_event( evPing );
+		}
+		bench_stop( &stamp, BENCH_BATCH );
+	}
+	bench_report( "event_signal", param );
+}
+
+
+/* Putting a task to sleep with param other tasks sleeping, which walks the
+delta list up to the wakeup time. The name tells whether the kernel keeps the
+list in the TCBs or in the separate array of OS_TASK_SOA. */
+#if defined( OS_TASK_SOA )
+#define SLEEP_BENCH		"sleep_insert_soa"
+#else
+#define SLEEP_BENCH		"sleep_insert_tcb"
+#endif
+
+static void bench_sleep_insert( uint32_t param ) {
+	uint32_t i, j;
+	os_tid_t tid = NO_TID;
+	os_init();
+	for ( i = 0; i != param + 1; ++i ) {
+		tid = os_task_create( idle_taskproc, 1 );
+		os_task_wait_time_set( tid, (uint16_t)( 1u + ( i * 7919u ) % 60000u ) );
+	}
+
+	for ( i = 0; i != SAMPLES / 16; ++i ) {
+		bench_start( &stamp );
+		for ( j = 0; j != BENCH_BATCH; ++j ) {
+			os_task_wait_time_set( tid, (uint16_t)( 1u + ( ( i * BENCH_BATCH + j ) * 1021u ) % 60000u ) );
+		}
+		bench_stop( &stamp, BENCH_BATCH );
+	}
+	bench_report( SLEEP_BENCH, param );
+}
+
+
+/* Pending on a semaphore and handing it over with param other tasks of the
+same priority waiting. The woken task is the next one to wait, so the wait
+list keeps its length. */
+static void bench_sem_wait_signal( uint32_t param ) {
+	uint32_t i, j;
+	os_tid_t spare = NO_TID;
+	os_init();
+	semPing = os_create_sem( 0 );
+	for ( i = 0; i != param + 1; ++i ) {
+		spare = os_task_create( idle_taskproc, 1 );
+		if ( i != param ) {
+			os_sem_wait( semPing, spare );
+		}
+	}
+
+	for ( i = 0; i != SAMPLES; ++i ) {
+		bench_start( &stamp );
+		for ( j = 0; j != BENCH_BATCH; ++j ) {
+			os_sem_wait( semPing, spare );
+			os_sem_signal( semPing );
+			spare = ( spare == param ) ? 0 : spare + 1;
+		}
+		bench_stop( &stamp, BENCH_BATCH );
+	}
+	bench_report( "sem_wait_signal", param );
+}
+
+
+/* Arms param timers far enough ahead that none expires during a benchmark */
+static void arm_timers( uint32_t param ) {
+	uint32_t i;
+	for ( i = 0; i != param; ++i ) {
+		os_create_timer_static( &timers[ i ], 0, 0, 0 );
+		os_timer_start( &timers[ i ], (uint16_t)( 20000u + ( i * 7919u ) % 45000u ), 0 );
+	}
+}
+
+
+/* os_timer_start() plus os_timer_stop() of one timer with param timers armed */
+static void bench_timer_start_stop( uint32_t param ) {
+	uint32_t i, j;
+	os_timer_type *timer = &timers[ MAX_TIMERS ];
+	os_init();
+	arm_timers( param );
+	os_create_timer_static( timer, 0, 0, 0 );
+
+	for ( i = 0; i != SAMPLES; ++i ) {
+		bench_start( &stamp );
+		for ( j = 0; j != BENCH_BATCH; ++j ) {
+			os_timer_start( timer, (uint16_t)( 1u + ( j * 1021u ) ), 0 );
+			os_timer_stop( timer );
+		}
+		bench_stop( &stamp, BENCH_BATCH );
+	}
+	bench_report( "timer_start_stop", param );
+}
+
+
+/* os_tick() with param timers armed of which none expires, the cascades
+included */
+static void bench_timer_tick( uint32_t param ) {
+	uint32_t i, j;
+	os_init();
+	arm_timers( param );
+
+	for ( i = 0; i != SAMPLES / 4; ++i ) {
+		bench_start( &stamp );
+		for ( j = 0; j != BENCH_BATCH; ++j ) {
+			os_tick();
+		}
+		bench_stop( &stamp, BENCH_BATCH );
+	}
+	bench_report( "timer_tick", param );
+}
+
+
+static void timer_sweep( const char *name, benchproctype proc ) {
+	uint32_t i;
+	if ( !bench_selected( name ) ) {
+		return;
+	}
+	for ( i = 0; i != N_TIMER_COUNTS; ++i ) {
+		bench_run( proc, timerCounts[ i ] );
+	}
+}
+
+
+static void sleep_sweep( const char *name, benchproctype proc ) {
+	uint32_t i;
+	if ( !bench_selected( name ) ) {
+		return;
+	}
+	for ( i = 0; i != N_SLEEPER_COUNTS; ++i ) {
+		if ( sleeperCounts[ i ] + 1 <= MAX_TASKS ) {
+			bench_run( proc, sleeperCounts[ i ] );
+		}
+	}
+}
+
+
+static void sweep( const char *name, benchproctype proc, uint32_t offset ) {
+	uint32_t i;
+	if ( !bench_selected( name ) ) {
+		return;
+	}
+	for ( i = 0; i != N_TASK_COUNTS; ++i ) {
+		if ( taskCounts[ i ] + offset <= MAX_TASKS ) {
+			bench_run( proc, taskCounts[ i ] );
+		}
+	}
+}
+
+
+int main( int argc, char *argv[] ) {
+	bench_init( argc, argv );
+
+	if ( bench_selected( "yield" ) ) {
+		bench_run( bench_yield, 1 );
+	}
+	if ( bench_selected( RESUME_BENCH ) ) {
+		bench_run( bench_resume, 32 );
+	}
+	if ( bench_selected( "event_latency" ) ) {
+		bench_run( bench_event_latency, 2 );
+	}
+	if ( bench_selected( "sem_pingpong" ) ) {
+		bench_run( bench_sem_pingpong, 2 );
+	}
+	if ( bench_selected( "tick" ) ) {
+		bench_run( bench_tick, 0 );
+	}
+	sweep( "tick", bench_tick, 0 );
+	sweep( "ready_select", bench_ready_select, 0 );
+	sweep( "event_signal", bench_event_signal, 1 );
+	sweep( "sem_wait_signal", bench_sem_wait_signal, 1 );
+	sleep_sweep( SLEEP_BENCH, bench_sleep_insert );
+	timer_sweep( "timer_start_stop", bench_timer_start_stop );
+	timer_sweep( "timer_tick", bench_timer_tick );
+	return 0;
+}
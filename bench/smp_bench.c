@@ -0,0 +1,92 @@
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: smp_bench.c
+***
+***     Project: cocoOS
+***
+***************************************************************************************
+***************************************************************************************
+*/
+
+/* Scaling of the multi-core scheduler with the number of worker threads:
+
+    gcc -O2 -I. -DOS_SMP -DMAX_TASKS=254 bench/smp_bench.c bench/bench.c os_*.c -o smp_bench -lpthread
+
+A fixed amount of cpu bound work is split in units, one unit per task
+activation. The benchmark is run once per worker count from 1 up to the number
+of cpus, each time in a fresh process, as os_smp_start() never returns. */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include "cocoos.h"
+#include "bench.h"
+
+
+#define N_TASKS		32
+#define N_UNITS		( BENCH_MAX_SAMPLES * BENCH_BATCH )
+#define UNIT_WORK	2000
+
+static uint32_t unitsDone;
+static uint32_t nWorkersRun;
+
+
+/* Stateless task procedure: each activation does one unit of work and stays
+ready. Every BENCH_BATCH units one sample is taken, so the per-unit cost of a
+sample falls when more workers share the work. */
+static int work_taskproc( void ) {
+	static bench_stamp stamp;
+	volatile uint32_t x = running_tid + 1;
+	uint32_t i;
+	uint32_t done;
+
+	for ( i = 0; i != UNIT_WORK; ++i ) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+	}
+
+	done = __atomic_add_fetch( &unitsDone, 1, __ATOMIC_RELAXED );
+	if ( ( done % BENCH_BATCH ) == 0 ) {
+		os_smp_lock();
+		if ( done != BENCH_BATCH ) {
+			bench_stop( &stamp, BENCH_BATCH );
+		}
+		bench_start( &stamp );
+		os_smp_unlock();
+	}
+	if ( done == N_UNITS ) {
+		os_smp_lock();
+		bench_report( "smp_throughput", nWorkersRun );
+		exit( 0 );
+	}
+	return 0;
+}
+
+
+static void bench_smp( uint32_t param ) {
+	uint32_t i;
+	nWorkersRun = param;
+	os_init();
+	for ( i = 0; i != N_TASKS; ++i ) {
+		os_task_create( work_taskproc, 0 );
+	}
+	os_smp_start( (uint8_t)param );
+}
+
+
+int main( int argc, char *argv[] ) {
+	long nCpus = sysconf( _SC_NPROCESSORS_ONLN );
+	uint32_t nWorkers;
+
+	bench_init( argc, argv );
+	if ( nCpus > OS_SMP_MAX_WORKERS ) {
+		nCpus = OS_SMP_MAX_WORKERS;
+	}
+
+	for ( nWorkers = 1; nWorkers <= (uint32_t)nCpus; ++nWorkers ) {
+		bench_run( bench_smp, nWorkers );
+	}
+	return 0;
+}
@@ -1,40 +1,89 @@
-#include <io.h>
-#include <interrupt.h>
-#include "cocoos.h"
-
-#define CPU_CLOCK 3686000
-#define N_PRESCALER_VALUES 5
-
-const uint8_t prescaler[] = { 0, 3, 6, 8, 10};
-static uint8_t counterValue;
-
-void clock_init(uint32_t tick_us) {
-	uint32_t nPulses;
-	TCCR0=0x00;
-	uint8_t i = 0;
-	do {
-        nPulses = ( CPU_CLOCK * tick_us / 1000000 ) / (1 << prescaler[ i ]);
-		if (( 0 < nPulses ) && ( nPulses < 256 )) {
-			counterValue = 256 - nPulses;
-			break;
-		}
-	} while ( ++i < N_PRESCALER_VALUES  );
-
-	if ( i < N_PRESCALER_VALUES ) {
-		TCNT0 = counterValue;
-		TCCR0 = ( (i+1) << CS00 );		
-	}
-	else {
-		TCNT0 = 0;
-		TCCR0 = (5 << CS00 );
-	}
-	
-	TIMSK=(1<<TOIE0);	/* Timer Overflow Interrupt Enabled */	
-}
-
-
-
-ISR(SIG_OVERFLOW0) {
-	TCNT0 = counterValue;
-    os_tick();	
-}
+#if defined( __AVR__ )
+
+#include <io.h>
+#include <interrupt.h>
+#include <sleep.h>
+#include "cocoos.h"
+
+#define CPU_CLOCK 3686000
+#define N_PRESCALER_VALUES 5
+
+const uint8_t prescaler[] = { 0, 3, 6, 8, 10};
+static uint8_t counterValue;
+
+/* Timer pulses elapsed up to the last tick, and the pulse frequency */
+static uint32_t timerPulses;
+static uint32_t timerHz;
+
+void clock_init(uint32_t tick_us) {
+	uint32_t nPulses;
+	TCCR0=0x00;
+	uint8_t i = 0;
+	do {
+        nPulses = ( CPU_CLOCK * tick_us / 1000000 ) / (1 << prescaler[ i ]);
+		if (( 0 < nPulses ) && ( nPulses < 256 )) {
+			counterValue = 256 - nPulses;
+			break;
+		}
+	} while ( ++i < N_PRESCALER_VALUES  );
+
+	if ( i < N_PRESCALER_VALUES ) {
+		TCNT0 = counterValue;
+		TCCR0 = ( (i+1) << CS00 );		
+	}
+	else {
+		i = N_PRESCALER_VALUES - 1;
+		TCNT0 = 0;
+		TCCR0 = (5 << CS00 );
+	}
+	timerHz = CPU_CLOCK >> prescaler[ i ];
+	
+	TIMSK=(1<<TOIE0);	/* Timer Overflow Interrupt Enabled */	
+}
+
+
+
+#ifdef OS_TICKLESS
+/* Timer 0 is too narrow to time a long sleep as a single one-shot, so the AVR
+keeps its periodic tick and only stops the CPU until the next interrupt. The
+tick ISR credits the ticks, hence nothing is returned for batch crediting. */
+uint16_t os_idle( uint16_t ticks ) {
+	(void)ticks;
+	set_sleep_mode( SLEEP_MODE_IDLE );
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+	return 0;
+}
+#endif
+
+
+
+/* Timer pulses since clock_init(), an overflow not yet handled by the ISR is
+missed, so a timestamp can be one tick early when read with interrupts off.
+The raw port critical section is used, the timed one of OS_IRQ_STATS reads
+the timestamp itself. */
+uint32_t os_port_timestamp( void ) {
+	uint32_t pulses;
+	os_cpu_sr sr;
+	OS_PORT_ENTER_CRITICAL( sr );
+	pulses = timerPulses + (uint8_t)( TCNT0 - counterValue );
+	OS_PORT_EXIT_CRITICAL( sr );
+	return pulses;
+}
+
+
+uint32_t os_port_timestamp_hz( void ) {
+	return timerHz;
+}
+
+
+
+ISR(SIG_OVERFLOW0) {
+	TCNT0 = counterValue;
+	timerPulses += 256 - counterValue;
+    os_int_tick();	
+}
+
+#endif
@@ -0,0 +1,146 @@
+/* Clock driver for the Linux port. A POSIX timer delivers the tick as a
+signal, which plays the role of the timer interrupt and calls os_int_tick(). */
+
+#define _GNU_SOURCE
+#include <inttypes.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include "cocoos.h"
+#include "clock.h"
+
+#if defined( OS_PORT_LINUX )
+
+#define NS_PER_SEC	1000000000ull
+
+static timer_t tickTimer;
+static uint64_t tickNs;
+
+/* Time of the last tick given to the kernel */
+static volatile uint64_t lastTick;
+
+
+static uint64_t clock_now( void ) {
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (uint64_t)now.tv_sec * NS_PER_SEC + now.tv_nsec;
+}
+
+
+static void clock_to_timespec( uint64_t ns, struct timespec *ts ) {
+	ts->tv_sec = ns / NS_PER_SEC;
+	ts->tv_nsec = ns % NS_PER_SEC;
+}
+
+
+/* Starts the periodic tick with the next tick one period after lastTick */
+static void clock_start_periodic( void ) {
+	struct itimerspec period;
+	clock_to_timespec( tickNs, &period.it_interval );
+	clock_to_timespec( lastTick + tickNs, &period.it_value );
+	timer_settime( tickTimer, TIMER_ABSTIME, &period, 0 );
+}
+
+
+#if defined( OS_SMP )
+static void clock_tick( union sigval value ) {
+	(void)value;
+	lastTick += tickNs;
+	os_int_tick();
+}
+#else
+static void clock_tick( int sig ) {
+	(void)sig;
+	lastTick += tickNs;
+	os_int_tick();
+}
+#endif
+
+
+void clock_init( uint32_t tick_us ) {
+	struct sigevent event;
+
+	tickNs = (uint64_t)tick_us * 1000;
+	lastTick = clock_now();
+
+	memset( &event, 0, sizeof( event ) );
+#if defined( OS_SMP )
+	/* The tick runs in a thread of its own and takes the kernel lock */
+	event.sigev_notify = SIGEV_THREAD;
+	event.sigev_notify_function = clock_tick;
+#else
+	{
+		struct sigaction action;
+		memset( &action, 0, sizeof( action ) );
+		action.sa_handler = clock_tick;
+		action.sa_flags = SA_RESTART;
+		sigfillset( &action.sa_mask );
+		sigaction( OS_PORT_TICK_SIGNAL, &action, 0 );
+	}
+	event.sigev_notify = SIGEV_SIGNAL;
+	event.sigev_signo = OS_PORT_TICK_SIGNAL;
+#endif
+	timer_create( CLOCK_MONOTONIC, &event, &tickTimer );
+	clock_start_periodic();
+}
+
+
+#if defined( OS_TICKLESS )
+/* Tickless idle: the periodic tick is stopped and a timerfd is armed for the
+next deadline. ppoll() unblocks the interrupt signals while it sleeps, so a
+simulated ISR still wakes the kernel. Ticks are counted from lastTick, which
+keeps the tick phase and thereby the wakeup accuracy across idle periods. */
+uint16_t os_idle( uint16_t ticks ) {
+	static int timerFd = -1;
+	struct itimerspec stop;
+	struct itimerspec deadline;
+	struct pollfd pfd;
+	sigset_t mask;
+	uint64_t elapsed;
+	uint64_t expirations;
+	int sig;
+
+	if ( timerFd < 0 ) {
+		timerFd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK );
+	}
+
+	memset( &stop, 0, sizeof( stop ) );
+	timer_settime( tickTimer, 0, &stop, 0 );
+
+	memset( &deadline, 0, sizeof( deadline ) );
+	if ( ticks != 0 ) {
+		clock_to_timespec( lastTick + ticks * tickNs, &deadline.it_value );
+	}
+	timerfd_settime( timerFd, TFD_TIMER_ABSTIME, &deadline, 0 );
+
+	/* Sleep with the interrupt signals unblocked */
+	sigprocmask( SIG_SETMASK, 0, &mask );
+	for ( sig = 1; sig < NSIG; ++sig ) {
+		if ( sigismember( os_port_irq_signals(), sig ) ) {
+			sigdelset( &mask, sig );
+		}
+	}
+	pfd.fd = timerFd;
+	pfd.events = POLLIN;
+	ppoll( &pfd, 1, 0, &mask );
+	if ( read( timerFd, &expirations, sizeof( expirations ) ) < 0 ) {
+		expirations = 0;
+	}
+
+	disable_interrupts();
+	elapsed = ( clock_now() - lastTick ) / tickNs;
+	if ( elapsed > 0xffff ) {
+		elapsed = 0xffff;
+	}
+	lastTick += elapsed * tickNs;
+	clock_start_periodic();
+	enable_interrupts();
+
+	return (uint16_t)elapsed;
+}
+#endif
+
+#endif
@@ -1,57 +1,224 @@
-#ifndef COCOOS_H
-#define COCOOS_H
-
-/** @file cocoos.h cocoOS kernel header file*/
-
-#include <inttypes.h>
-#include "os_defines.h"
-#include "os_event.h"
-#include "os_lists.h"
-#include "os_sem.h"
-#include "os_task.h"
-
-
-#define OS_BEGIN            static uint8_t state = 0; switch ( state ) { case 0:
-#define OS_END	            state = 0; }
-#define OS_SCHEDULE         running_tid = NO_TID;\
-					        state = __LINE__;\
-					        return 0;\
-					        case __LINE__:
-
-
-/*********************************************************************************/
-/*  OS_WAIT_TICKS(x)                                                 *//**
-*   
-*   Macro for suspending a task a specified amount of ticks.
-*
-*		@param x Number of ticks to wait.
-*
-*		@remarks \b Usage: @n 
-* @code 
-
-
-static int myTask(void) {
- OS_BEGIN;	
-  ...
-  OS_WAIT_TICKS( 10 );
-  ...
- OS_END;
- return 0;
-}
- @endcode 
- *******************************************************************************/
-#define OS_WAIT_TICKS(x)    OS_WAIT_TICKS_(x)
-#define OS_WAIT_TICKS_(x)	do {\
-								os_task_wait_time_set( running_tid, x );\
-								OS_SCHEDULE;\
-						   	   } while ( 0 )
-
-
-#define OS_GET_TID()        running_tid
-
-uint8_t running_tid;
-void os_init( void );
-void os_start( void );
-void os_tick( void );
-
-#endif
+#ifndef COCOOS_H
+#define COCOOS_H
+
+/** @file cocoos.h cocoOS kernel header file*/
+
+#include <inttypes.h>
+#include "os_defines.h"
+#include "os_trace.h"
+#include "os_event.h"
+#include "os_lists.h"
+#include "os_sem.h"
+#include "os_mutex.h"
+#include "os_msgq.h"
+#include "os_ring.h"
+#include "os_task.h"
+#include "os_timer.h"
+
+
+/* The resume point of a task is kept in its task control block, not in the
+task procedure, so one procedure can back several tasks. OS_BEGIN fetches it
+once per call. Only one OS_SCHEDULE, including the ones inside the OS_ macros,
+may be placed on a source line. */
+#if defined( OS_RESUME_GOTO )
+
+#define OS_RESUME_LABEL( line )		OS_RESUME_LABEL_( line )
+#define OS_RESUME_LABEL_( line )	os_resume_##line
+
+#define OS_BEGIN            os_resume_type *os_resume_ = os_task_resume_get( running_tid );\
+					        if ( *os_resume_ != 0 ) { goto **os_resume_; } {
+#define OS_END	            *os_resume_ = 0; }
+#define OS_SCHEDULE         running_tid = NO_TID;\
+					        *os_resume_ = &&OS_RESUME_LABEL( __LINE__ );\
+					        return 0;\
+					        OS_RESUME_LABEL( __LINE__ ):
+
+#else
+
+#define OS_BEGIN            os_resume_type *os_resume_ = os_task_resume_get( running_tid );\
+					        switch ( *os_resume_ ) { case 0:
+#define OS_END	            *os_resume_ = 0; }
+#define OS_SCHEDULE         running_tid = NO_TID;\
+					        *os_resume_ = __LINE__;\
+					        return 0;\
+					        case __LINE__:
+
+#endif
+
+
+/*********************************************************************************/
+/*  OS_WAIT_TICKS(x)                                                 *//**
+*   
+*   Macro for suspending a task a specified amount of ticks.
+*
+*		@param x Number of ticks to wait.
+*
+*		@remarks \b Usage: @n 
+* @code 
+
+
+static int myTask(void) {
+ OS_BEGIN;	
+  ...
+  OS_WAIT_TICKS( 10 );
+  ...
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_WAIT_TICKS(x)    OS_WAIT_TICKS_(x)
+#define OS_WAIT_TICKS_(x)	do {\
+								os_task_wait_time_set( running_tid, x );\
+								OS_SCHEDULE;\
+						   	   } while ( 0 )
+
+
+/*********************************************************************************/
+/*  OS_WAIT_NEXT_PERIOD()                                                 *//**
+*   
+*   Macro for suspending a periodic task until its next period starts. The
+*   periods are kept on absolute ticks, so unlike OS_WAIT_TICKS() the loop
+*   does not drift by the time the task takes to run. A task that is already
+*   past its next release continues at once and counts an overrun, see
+*   os_task_overruns_get().
+*
+*		@remarks \b Usage: @n The period is given with os_task_create_periodic()
+*       or os_task_period_set().
+* @code 
+static int ledTask(void) {
+ OS_BEGIN;	
+  ...
+  OS_WAIT_NEXT_PERIOD();
+  ...
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_WAIT_NEXT_PERIOD()	do {\
+								os_task_wait_next_period( running_tid );\
+								OS_SCHEDULE;\
+						   	   } while ( 0 )
+
+
+/*********************************************************************************/
+/*  OS_TASK_EXIT()                                                 *//**
+*   
+*   Macro ending the calling task, see os_task_delete(). A task procedure
+*   reaching OS_END starts over from OS_BEGIN the next time it runs, a task
+*   that is done places OS_TASK_EXIT() before OS_END instead.
+*
+*		@remarks \b Usage: @n The tid and task control block of the task are
+*       reused by the next task created.
+* @code 
+static int requestTask(void) {
+ Request *req = OS_GET_ARG();
+ OS_BEGIN;	
+  OS_WAIT_SEM( req->reply );
+  handle( req );
+  OS_TASK_EXIT();
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_TASK_EXIT()		do {\
+								os_task_delete( running_tid );\
+								running_tid = NO_TID;\
+								*os_resume_ = 0;\
+								return 0;\
+						   	   } while ( 0 )
+
+
+#define OS_GET_TID()        running_tid
+
+
+/*********************************************************************************/
+/*  OS_TIMED_OUT()                                                 *//**
+*   
+*   Macro telling whether the last OS_WAIT_SEM_TIMEOUT(),
+*   OS_WAIT_SINGLE_EVENT_TIMEOUT() or OS_WAIT_MULTIPLE_EVENTS_TIMEOUT() of the
+*   running task ended because its timeout expired.
+*
+*		@return 1 if the wait timed out, 0 if the semaphore or event came first.
+*
+ *******************************************************************************/
+#define OS_TIMED_OUT()      os_task_timed_out( running_tid )
+
+
+/*********************************************************************************/
+/*  OS_GET_ARG()                                                 *//**
+*   
+*   Macro returning the argument the running task was created with by
+*   os_task_create_arg(), 0 for tasks created without one.
+*
+*		@remarks \b Usage: @n Lets one task procedure serve several tasks, each
+*       keeping its variables in its own context instead of in statics. Fetch
+*       the context before OS_BEGIN, as it must be valid after every resume.
+* @code 
+typedef struct {
+  uint8_t channel;
+  uint16_t count;
+} ChannelCtx;
+
+static int channelTask(void) {
+ ChannelCtx *ctx = OS_GET_ARG();
+ OS_BEGIN;	
+  ...
+  ctx->count++;
+  OS_WAIT_TICKS( 10 );
+  ...
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_GET_ARG()        os_task_arg_get( running_tid )
+
+extern OS_THREAD_LOCAL os_tid_t running_tid;
+void os_init( void );
+void os_start( void );
+os_tid_t os_schedule( void );
+void os_tick( void );
+void os_int_tick( void );
+uint32_t os_int_ticks_lost( void );
+void os_int_signal_event( os_event_type *ev );
+uint32_t os_tick_count( void );
+#if defined( OS_SMP )
+void os_smp_start( uint8_t nWorkers );
+uint8_t os_smp_workers( void );
+#endif
+#if defined( OS_IRQ_STATS )
+uint32_t os_irq_off_max( void );
+#endif
+#if defined( OS_TASK_STATS )
+uint8_t os_cpu_load( void );
+void os_cpu_idle_add( uint32_t time );
+#endif
+
+
+/*********************************************************************************/
+/*  uint16_t os_idle( uint16_t ticks )                                 *//**
+*   
+*   Idle hook used in tickless mode, i.e. when the kernel is built with
+*   OS_TICKLESS defined. It is provided by the clock driver, not by the kernel.
+*
+*		@param ticks Number of ticks until the next sleeping task is due,
+*       0 if no task is sleeping.
+*
+*		@return Number of ticks that elapsed while idling and were not already
+*       given to os_tick().
+*
+*		@remarks \b Usage: @n os_start() calls this with interrupts disabled when
+*       no task is ready. The hook should program a one-shot timer for the
+*       deadline, stop the periodic tick, enable interrupts and put the CPU to
+*       sleep as one atomic step. It returns when the deadline is reached or an
+*       interrupt woke the CPU. The kernel credits the returned ticks in one batch.
+*
+ *******************************************************************************/
+#ifdef OS_TICKLESS
+uint16_t os_idle( uint16_t ticks );
+#endif
+
+#endif
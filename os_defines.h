@@ -1,29 +1,169 @@
-#ifndef _os_defs
-#define _os_defs
-
-#include <interrupt.h>
-#ifndef TRUE
-#define TRUE	1
-#endif
-
-#ifndef FALSE
-#define FALSE	0
-#endif
-
-#define MAX_TASKS 6
-#define NO_TID	255
-
-#define enable_interrupts()		sei()
-#define disable_interrupts()	cli()
-
-typedef uint8_t		Bool;
-
-
-
-typedef int (*taskproctype) (void);
-
-
-
-
-
-#endif
+#ifndef _os_defs
+#define _os_defs
+
+#include "os_port.h"
+#ifndef TRUE
+#define TRUE	1
+#endif
+
+#ifndef FALSE
+#define FALSE	0
+#endif
+
+#ifndef MAX_TASKS
+#define MAX_TASKS 6
+#endif
+
+/* Task ids are 8 bits wide, which allows up to 254 tasks. A host running
+thousands of tasks defines OS_TID_BITS as 16. NO_TID is the largest id. */
+#ifndef OS_TID_BITS
+#define OS_TID_BITS	8
+#endif
+
+#if OS_TID_BITS == 8
+typedef uint8_t		os_tid_t;
+#define NO_TID	255
+#elif OS_TID_BITS == 16
+typedef uint16_t	os_tid_t;
+#define NO_TID	65535u
+#else
+#error "OS_TID_BITS must be 8 or 16"
+#endif
+
+#if MAX_TASKS >= NO_TID
+#error "MAX_TASKS must be below NO_TID, define OS_TID_BITS as 16 for more tasks"
+#endif
+
+/* Maximum number of events. A task waits on a set of events, kept as a bit
+set of OS_EVENT_SET_WORDS words of OS_EVENT_WORD_BITS (8, 16, 32 or 64) bits.
+Wait and signal operations work on whole words, so pick the native word size
+of the target when many events are used. */
+#ifndef OS_MAX_EVENTS
+#define OS_MAX_EVENTS	8
+#endif
+
+#ifndef OS_EVENT_WORD_BITS
+#define OS_EVENT_WORD_BITS	8
+#endif
+
+#if OS_EVENT_WORD_BITS == 8
+typedef uint8_t		os_event_word;
+#elif OS_EVENT_WORD_BITS == 16
+typedef uint16_t	os_event_word;
+#elif OS_EVENT_WORD_BITS == 32
+typedef uint32_t	os_event_word;
+#elif OS_EVENT_WORD_BITS == 64
+typedef uint64_t	os_event_word;
+#else
+#error "OS_EVENT_WORD_BITS must be 8, 16, 32 or 64"
+#endif
+
+#define OS_EVENT_SET_WORDS	( ( OS_MAX_EVENTS + OS_EVENT_WORD_BITS - 1 ) / OS_EVENT_WORD_BITS )
+
+/* Number of events a task can wait for at the same time. Every TCB holds
+this many waiter nodes of two links, an event pointer and a tid each, 7 bytes
+apiece on AVR with 8 bit tids, so 8 of them add 56 bytes of ram per task.
+Waiting for more events than this fails, see os_wait_multiple(). */
+#ifndef OS_MAX_WAIT_EVENTS
+#if OS_MAX_EVENTS < 8
+#define OS_MAX_WAIT_EVENTS	OS_MAX_EVENTS
+#else
+#define OS_MAX_WAIT_EVENTS	8
+#endif
+#endif
+
+#if ( OS_MAX_WAIT_EVENTS < 1 ) || ( OS_MAX_WAIT_EVENTS > 255 )
+#error "OS_MAX_WAIT_EVENTS must be between 1 and 255"
+#endif
+
+#if OS_MAX_EVENTS > 65535
+#error "OS_MAX_EVENTS must be at most 65535"
+#elif OS_MAX_EVENTS > 255
+typedef uint16_t	os_event_id;
+#else
+typedef uint8_t		os_event_id;
+#endif
+
+typedef struct {
+	os_event_word word[ OS_EVENT_SET_WORDS ];
+} os_event_set;
+
+#define OS_EVENT_WORD( id )	( (id) / OS_EVENT_WORD_BITS )
+#define OS_EVENT_MASK( id )	( (os_event_word)1 << ( (id) % OS_EVENT_WORD_BITS ) )
+
+/* Number of kernel objects of each kind in the static pools used by
+os_task_create(), os_create_event(), os_create_sem(), os_create_mutex() and
+os_create_msgq(). Objects created from caller provided storage with the
+_static variants do not count. */
+#ifndef OS_TASK_POOL_SIZE
+#define OS_TASK_POOL_SIZE	MAX_TASKS
+#endif
+
+#ifndef OS_EVENT_POOL_SIZE
+#define OS_EVENT_POOL_SIZE	OS_MAX_EVENTS
+#endif
+
+#ifndef OS_SEM_POOL_SIZE
+#define OS_SEM_POOL_SIZE	4
+#endif
+
+#ifndef OS_MUTEX_POOL_SIZE
+#define OS_MUTEX_POOL_SIZE	2
+#endif
+
+#ifndef OS_MSGQ_POOL_SIZE
+#define OS_MSGQ_POOL_SIZE	2
+#endif
+
+/* Number of priority levels, 0 is the highest. Each level costs two bytes
+of ram for its ready queue, so small targets may lower this. Task priorities
+above the last level are clamped to it. */
+#ifndef OS_NUM_PRIO
+#define OS_NUM_PRIO 256
+#endif
+
+/* Number of event signals an ISR can post with os_int_signal_event() before
+the scheduler applies them, a power of two of at most 128 */
+#ifndef OS_INT_QUEUE_SIZE
+#define OS_INT_QUEUE_SIZE	8
+#endif
+
+#if ( OS_INT_QUEUE_SIZE & ( OS_INT_QUEUE_SIZE - 1 ) ) || ( OS_INT_QUEUE_SIZE > 128 )
+#error "OS_INT_QUEUE_SIZE must be a power of two, at most 128"
+#endif
+
+/* With OS_EDF defined, tasks given a relative deadline with
+os_task_deadline_set() are scheduled earliest deadline first, ahead of all
+tasks without a deadline, which keep their priority scheduling. */
+#if defined( OS_EDF ) && defined( OS_SMP )
+#error "OS_EDF is not supported together with OS_SMP"
+#endif
+
+/* With OS_TICKLESS defined, the scheduler sleeps in os_idle() until the next
+deadline when no task is ready. The SMP workers keep the periodic tick. */
+#if defined( OS_TICKLESS ) && defined( OS_SMP )
+#error "OS_TICKLESS is not supported together with OS_SMP"
+#endif
+
+typedef uint8_t		Bool;
+
+
+
+typedef int (*taskproctype) (void);
+
+/* Resume point of a task procedure. With GCC and clang it is the address of
+the label following the last yield, so a resume is one indirect jump. Other
+compilers, or OS_RESUME_SWITCH defined, get a switch on the line number of the
+yield, 16 bits wide so that yields past line 255 work. */
+#if defined( __GNUC__ ) && !defined( OS_RESUME_SWITCH )
+#define OS_RESUME_GOTO
+typedef void*		os_resume_type;
+#else
+typedef uint16_t	os_resume_type;
+#endif
+
+
+
+
+
+#endif
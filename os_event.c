@@ -1,136 +1,191 @@
-/*
-***************************************************************************************
-***************************************************************************************
-***
-***     File: os_event.c
-***
-***     Project: cocoOS
-***
-***     Author: Peter Eckstrand
-***
-***************************************************************************************
-***************************************************************************************
-
-
-    Version: 1.0.0
-
-    Change log:
-    2009-07-06: 1.0.0 First release
-
-
-***************************************************************************************
-*/
-
-
-
-
-
-
-#include <inttypes.h>
-#include <stdlib.h>
-#include "cocoos.h"
-#include "stdarg.h"
-
-
-
-/* Event type */
-struct event {
-		uint8_t id;
-		uint8_t signaledByTid;
-		};
-
-/* Keeping track of number of created events */
-static uint8_t nEvents = 1;
-
-
-/*********************************************************************************/
-/*  os_event_type* os_create_event()                                              *//**
-*   
-*   Creates an event.
-*
-*		@return Returns a pointer to the created event.
-*
-*		@remarks \b Usage: @n An event is created by declaring a variable of type os_event_type* and then
-*		assigning the os_create_event(value) return value to that variable.
-*	
-*		
-*       @code
-*       os_event_type* myEvent;
-*       myEvent = os_create_event();
-*		@endcode
-*       
-*		 */
-/*********************************************************************************/
-
-os_event_type* os_create_event( void ) {
-	os_event_type *temp_event =  malloc( sizeof( os_event_type ) );
-	temp_event->id = nEvents;
-
-	/* The events get id's 1, 2, 4, 8, 16 ... */
-	nEvents *= 2;
-
-	return temp_event;
-}
-
-
-void os_wait_event(uint8_t tid, os_event_type *ev, uint8_t waitSingleEvent) {
-	os_task_wait_event( tid, ev->id, waitSingleEvent );
-}
-
-
-void os_signal_event( os_event_type *ev ) {
-    os_task_signal_event( ev->id );
-}
-
-
-void os_event_set_signaling_tid( os_event_type *ev, uint8_t tid ) {
-	ev->signaledByTid = tid;
-}
-
-
-/*********************************************************************************/
-/*  uint8_t os_event_get_signaling_tid()                                              *//**
-*   
-*   Gets the Task Id of the task that signaled the event.
-*
-*   
-*    @param pEv Pointer to an event
-*
-*    @return Id of task that signaled the event.
-*
-*    @remarks \b Usage: @n A task can make a call to this function when it has resumed
-execution after waiting for an event to find out which other task signaled the event.
-*	
-*		
-*       @code
-*       OS_WAIT_SINGLE_EVENT(pEvent);
-*       signalingTask = os_event_get_signaling_tid(pEvent);
-*       if ( signalingTask == Task2_id ) {
-*         ...
-*       }
-*		@endcode		
-*       
-*		 */
-/*********************************************************************************/
-uint8_t os_event_get_signaling_tid( os_event_type *pEv ) {
-	return pEv->signaledByTid;
-}
-
-
-void os_wait_multiple( uint8_t waitAll, ...) {
-	os_event_type *event;
-	va_list args;
-	va_start( args, waitAll );
-	os_task_clear_wait_queue( running_tid );
-	event = va_arg( args, os_event_type* );
-
-	do {
-		os_task_wait_event( running_tid, event->id, !waitAll );
-		event = va_arg( args, os_event_type* );
-	} while ( event != (void*)0 );
-
-	va_end(args);
-}
-
-
-
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_event.c
+***
+***     Project: cocoOS
+***
+***     Author: Peter Eckstrand
+***
+***************************************************************************************
+***************************************************************************************
+
+
+    Version: 1.0.0
+
+    Change log:
+    2009-07-06: 1.0.0 First release
+
+
+***************************************************************************************
+*/
+
+
+
+
+
+
+#include <inttypes.h>
+#include <assert.h>
+#include "cocoos.h"
+#include "stdarg.h"
+
+
+
+/* Keeping track of number of created events */
+static os_event_id nEvents = 0;
+
+#if OS_EVENT_POOL_SIZE > 0
+static os_event_type event_pool[ OS_EVENT_POOL_SIZE ];
+#endif
+static os_event_id nPoolEvents = 0;
+
+
+/*********************************************************************************/
+/*  os_event_type* os_create_event()                                              *//**
+*   
+*   Creates an event, taken from a static pool of OS_EVENT_POOL_SIZE events.
+*
+*		@return Returns a pointer to the created event, or 0 if the pool is exhausted.
+*
+*		@remarks \b Usage: @n An event is created by declaring a variable of type os_event_type* and then
+*		assigning the os_create_event(value) return value to that variable.
+*	
+*		
+*       @code
+*       os_event_type* myEvent;
+*       myEvent = os_create_event();
+*		@endcode
+*       
+*		 */
+/*********************************************************************************/
+
+os_event_type* os_create_event( void ) {
+#if OS_EVENT_POOL_SIZE > 0
+	if ( nPoolEvents != OS_EVENT_POOL_SIZE ) {
+		os_event_type *temp_event = os_create_event_static( &event_pool[ nPoolEvents ] );
+		if ( temp_event != 0 ) {
+			++nPoolEvents;
+		}
+		return temp_event;
+	}
+#endif
+	return 0;
+}
+
+
+/*********************************************************************************/
+/*  os_event_type* os_create_event_static()                                              *//**
+*   
+*   Creates an event in storage provided by the caller.
+*
+*		@param storage Pointer to the event to initialize.
+*
+*		@return Returns storage, or 0 if all OS_MAX_EVENTS event ids are used.
+*	
+*		
+*       @code
+*       static os_event_type myEventStorage;
+*       os_event_type* myEvent;
+*       myEvent = os_create_event_static( &myEventStorage );
+*		@endcode
+*       
+*		 */
+/*********************************************************************************/
+os_event_type* os_create_event_static( os_event_type *storage ) {
+	if ( nEvents == OS_MAX_EVENTS ) {
+		return 0;
+	}
+
+	/* The events get id's 0, 1, 2, 3 ... each naming one bit in an event set */
+	storage->id = nEvents;
+	storage->signaledByTid = NO_TID;
+	storage->waiters = 0;
+	++nEvents;
+
+	return storage;
+}
+
+
+/* Returns the largest number of events ever taken from the pool */
+os_event_id os_event_pool_high_water( void ) {
+	return nPoolEvents;
+}
+
+
+uint8_t os_wait_event(os_tid_t tid, os_event_type *ev, uint8_t waitSingleEvent) {
+	OS_TRACE_RECORD( OS_TRACE_EVENT_WAIT, tid, ev->id );
+	return os_task_wait_event( tid, ev, waitSingleEvent );
+}
+
+
+void os_signal_event( os_event_type *ev ) {
+	OS_TRACE_RECORD( OS_TRACE_EVENT_SIGNAL, running_tid, ev->id );
+    os_task_signal_event( ev );
+}
+
+
+void os_event_set_signaling_tid( os_event_type *ev, os_tid_t tid ) {
+	ev->signaledByTid = tid;
+}
+
+
+/*********************************************************************************/
+/*  os_tid_t os_event_get_signaling_tid()                                              *//**
+*   
+*   Gets the Task Id of the task that signaled the event.
+*
+*   
+*    @param pEv Pointer to an event
+*
+*    @return Id of task that signaled the event.
+*
+*    @remarks \b Usage: @n A task can make a call to this function when it has resumed
+execution after waiting for an event to find out which other task signaled the event.
+*	
+*		
+*       @code
+*       OS_WAIT_SINGLE_EVENT(pEvent);
+*       signalingTask = os_event_get_signaling_tid(pEvent);
+*       if ( signalingTask == Task2_id ) {
+*         ...
+*       }
+*		@endcode		
+*       
+*		 */
+/*********************************************************************************/
+os_tid_t os_event_get_signaling_tid( os_event_type *pEv ) {
+	return pEv->signaledByTid;
+}
+
+
+/* Puts the running task in a wait for the listed events. Waiting for more
+than OS_MAX_WAIT_EVENTS events is an error. The assert catches it in debug
+builds; otherwise the task does not wait at all and 0 is returned, so no
+event is dropped silently from a wait for all. */
+uint8_t os_wait_multiple( uint8_t waitAll, ...) {
+	os_event_type *event;
+	uint8_t waiting = 1;
+	va_list args;
+	va_start( args, waitAll );
+	os_task_clear_wait_queue( running_tid );
+	event = va_arg( args, os_event_type* );
+
+	do {
+		OS_TRACE_RECORD( OS_TRACE_EVENT_WAIT, running_tid, event->id );
+		waiting = os_task_wait_event( running_tid, event, !waitAll );
+		event = va_arg( args, os_event_type* );
+	} while ( waiting && ( event != (void*)0 ) );
+
+	va_end(args);
+
+	if ( !waiting ) {
+		os_task_clear_wait_queue( running_tid );
+	}
+	assert( waiting );
+	return waiting;
+}
+
+
+
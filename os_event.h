@@ -1,164 +1,253 @@
-#ifndef OS_EVENT_H
-#define OS_EVENT_H
-
-/** @file os_event.h Event header file*/
-
-#include "cocoos.h"
-#include "stdarg.h"
-
-
-/*********************************************************************************/
-/*  OS_WAIT_SINGLE_EVENT(pEvent)                                                 *//**
-*   
-*   Macro for wait for a single event.
-*
-*		@param pEvent Pointer to an event.
-*
-*		@remarks \b Usage: @n 
-* @code 
-os_event_type* myEvent;
-main() {
- ...
- myEvent = os_create_event();
- ...
-}
-
-static int myTask(void) {
- OS_BEGIN;	
-  ...
-  OS_WAIT_SINGLE_EVENT( myEvent );
-  ...
- OS_END;
- return 0;
-}
- @endcode 
- *******************************************************************************/
-#define OS_WAIT_SINGLE_EVENT(pEvent) OS_WAIT_SINGLE_EVENT_(pEvent)
-#define OS_WAIT_SINGLE_EVENT_(x)	do {\
-								os_wait_event(running_tid,x,1);\
-								OS_SCHEDULE;\
-							   } while (0)
-
-
-
-
-/*********************************************************************************/
-/*  OS_WAIT_MULTIPLE_EVENTS(waitAll, args...)                                                 *//**
-*   
-*   Macro for wait for multiple events.
-*
-*		@param waitAll 1 if wait for all, 0 if wait for any event
-*       @param args... list of os_event_type pointers
-*
-*		@remarks \b Usage: @n 
-* @code 
-os_event_type* myEvent1;
-os_event_type* myEvent2;
-os_event_type* myEvent3;
-main() {
- ...
- myEvent1 = os_create_event();
- myEvent2 = os_create_event();
- myEvent3 = os_create_event();
- ...
-}
-
-static int myTask(void) {
- OS_BEGIN;	
-  ...
-  OS_WAIT_MULTIPLE_EVENTS(1, myEvent1, myEvent2, myEvent3);
-  ...
- OS_END;
- return 0;
-}
- @endcode 
- *******************************************************************************/
-#define OS_WAIT_MULTIPLE_EVENTS( waitAll, args...) OS_WAIT_MULTIPLE_EVENTS_( waitAll, args...)
-#define OS_WAIT_MULTIPLE_EVENTS_( waitAll, args...)	do {\
-								os_wait_multiple(waitAll, args, 0);\
-								OS_SCHEDULE;\
-							   } while (0)
-
-
-
-
-/*********************************************************************************/
-/*  OS_SIGNAL_EVENT(pEvent)                                                 *//**
-*   
-*   Macro for signalling an event.
-*
-*		@param pEvent Pointer to an event.
-*       
-*
-*		@remarks \b Usage: @n 
-* @code 
-os_event_type* myEvent;
-main() {
- ...
- myEvent = os_create_event();
- ...
-}
-
-static int myTask(void) {
- OS_BEGIN;	
-  ...
-  OS_SIGNAL_EVENT( myEvent );
-  ...
- OS_END;
- return 0;
-}
- @endcode 
- *******************************************************************************/
-#define OS_SIGNAL_EVENT(pEvent) OS_SIGNAL_EVENT_(pEvent)
-#define OS_SIGNAL_EVENT_(pEvent)	do {\
-								os_signal_event(pEvent);\
-								os_event_set_signaling_tid( pEvent, running_tid );\
-								OS_SCHEDULE;\
-								} while (0)
-
-
-
-/*********************************************************************************/
-/*  OS_INT_SIGNAL_EVENT(pEvent)                                                 *//**
-*   
-*   Macro for signalling an event from an ISR
-*
-*		@param pEvent Pointer to an event.
-*       
-*
-*		@remarks \b Usage: @n 
-* @code 
-os_event_type* myEvent;
-main() {
- ...
- evRxChar = os_create_event();
- ...
-}
-
-ISR (SIG_UART_RECV)
-{
-	rx.data[ rx.head ] = UDR;
-	OS_INT_SIGNAL_EVENT( evRxChar );
-	
-}
- @endcode 
- *******************************************************************************/
-#define OS_INT_SIGNAL_EVENT(pEvent) OS_INT_SIGNAL_EVENT_(pEvent)
-#define OS_INT_SIGNAL_EVENT_(pEvent)	do {\
-									os_signal_event(pEvent);\
-									} while (0)
-
-
-typedef struct event os_event_type;
-
-
-
-os_event_type* os_create_event( void );
-void os_wait_event( uint8_t tid, os_event_type *ev, uint8_t waitSingleEvent );
-void os_wait_multiple( uint8_t waitAll, ...);
-void os_signal_event( os_event_type *ev );
-void os_event_set_signaling_tid( os_event_type *ev, uint8_t tid );
-uint8_t os_event_get_signaling_tid( os_event_type *ev );
-
-
-#endif
+#ifndef OS_EVENT_H
+#define OS_EVENT_H
+
+/** @file os_event.h Event header file*/
+
+#include "cocoos.h"
+#include "stdarg.h"
+
+
+/*********************************************************************************/
+/*  OS_WAIT_SINGLE_EVENT(pEvent)                                                 *//**
+*   
+*   Macro for wait for a single event.
+*
+*		@param pEvent Pointer to an event.
+*
+*		@remarks \b Usage: @n 
+* @code 
+os_event_type* myEvent;
+main() {
+ ...
+ myEvent = os_create_event();
+ ...
+}
+
+static int myTask(void) {
+ OS_BEGIN;	
+  ...
+  OS_WAIT_SINGLE_EVENT( myEvent );
+  ...
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_WAIT_SINGLE_EVENT(pEvent) OS_WAIT_SINGLE_EVENT_(pEvent)
+#define OS_WAIT_SINGLE_EVENT_(x)	do {\
+								os_wait_event(running_tid,x,1);\
+								OS_SCHEDULE;\
+							   } while (0)
+
+
+
+
+/*********************************************************************************/
+/*  OS_WAIT_MULTIPLE_EVENTS(waitAll, args...)                                                 *//**
+*   
+*   Macro for wait for multiple events.
+*
+*		@param waitAll 1 if wait for all, 0 if wait for any event
+*       @param args... list of os_event_type pointers, at most OS_MAX_WAIT_EVENTS,
+*       a longer list does not compile
+*
+*		@remarks \b Usage: @n 
+* @code 
+os_event_type* myEvent1;
+os_event_type* myEvent2;
+os_event_type* myEvent3;
+main() {
+ ...
+ myEvent1 = os_create_event();
+ myEvent2 = os_create_event();
+ myEvent3 = os_create_event();
+ ...
+}
+
+static int myTask(void) {
+ OS_BEGIN;	
+  ...
+  OS_WAIT_MULTIPLE_EVENTS(1, myEvent1, myEvent2, myEvent3);
+  ...
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+/* Fails to compile when more events are listed than a task can wait for,
+the array size turns negative */
+#define OS_WAIT_EVENTS_CHECK_( args...)	( (void)sizeof( char[ ( sizeof( (os_event_type*[]){ args } ) / sizeof( os_event_type* ) <= OS_MAX_WAIT_EVENTS ) ? 1 : -1 ] ) )
+
+#define OS_WAIT_MULTIPLE_EVENTS( waitAll, args...) OS_WAIT_MULTIPLE_EVENTS_( waitAll, args)
+#define OS_WAIT_MULTIPLE_EVENTS_( waitAll, args...)	do {\
+								OS_WAIT_EVENTS_CHECK_( args );\
+								os_wait_multiple(waitAll, args, 0);\
+								OS_SCHEDULE;\
+							   } while (0)
+
+
+/*********************************************************************************/
+/*  OS_WAIT_SINGLE_EVENT_TIMEOUT(pEvent, ticks)                                                 *//**
+*   
+*   Macro for waiting for an event, giving up after a number of ticks.
+*
+*		@param pEvent Pointer to an event.
+*       @param ticks Number of ticks to wait at most, 0 waits forever.
+*
+*		@remarks \b Usage: @n OS_TIMED_OUT() tells whether the event was
+*       signaled or the wait timed out.
+* @code 
+static int myTask(void) {
+ OS_BEGIN;	
+  ...
+  OS_WAIT_SINGLE_EVENT_TIMEOUT( evRxChar, 50 );
+  if ( OS_TIMED_OUT() ) {
+    ...
+  }
+  ...
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_WAIT_SINGLE_EVENT_TIMEOUT(pEvent, ticks) OS_WAIT_SINGLE_EVENT_TIMEOUT_(pEvent, ticks)
+#define OS_WAIT_SINGLE_EVENT_TIMEOUT_(x, ticks)	do {\
+								os_wait_event(running_tid,x,1);\
+								os_task_timeout_set(running_tid,ticks);\
+								OS_SCHEDULE;\
+							   } while (0)
+
+
+/*********************************************************************************/
+/*  OS_WAIT_MULTIPLE_EVENTS_TIMEOUT(waitAll, ticks, args...)                                                 *//**
+*   
+*   Macro for waiting for multiple events, giving up after a number of ticks.
+*
+*		@param waitAll 1 if wait for all, 0 if wait for any event
+*       @param ticks Number of ticks to wait at most, 0 waits forever.
+*       @param args... list of os_event_type pointers, at most OS_MAX_WAIT_EVENTS,
+*       a longer list does not compile
+*
+*		@remarks \b Usage: @n OS_TIMED_OUT() tells whether the wait timed out.
+*       When waiting for all events, the events signaled before the timeout
+*       are lost.
+* @code 
+static int myTask(void) {
+ OS_BEGIN;	
+  ...
+  OS_WAIT_MULTIPLE_EVENTS_TIMEOUT( 1, 100, myEvent1, myEvent2 );
+  ...
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_WAIT_MULTIPLE_EVENTS_TIMEOUT( waitAll, ticks, args...) OS_WAIT_MULTIPLE_EVENTS_TIMEOUT_( waitAll, ticks, args)
+#define OS_WAIT_MULTIPLE_EVENTS_TIMEOUT_( waitAll, ticks, args...)	do {\
+								OS_WAIT_EVENTS_CHECK_( args );\
+								os_wait_multiple(waitAll, args, 0);\
+								os_task_timeout_set(running_tid,ticks);\
+								OS_SCHEDULE;\
+							   } while (0)
+
+
+
+
+/*********************************************************************************/
+/*  OS_SIGNAL_EVENT(pEvent)                                                 *//**
+*   
+*   Macro for signalling an event.
+*
+*		@param pEvent Pointer to an event.
+*       
+*
+*		@remarks \b Usage: @n 
+* @code 
+os_event_type* myEvent;
+main() {
+ ...
+ myEvent = os_create_event();
+ ...
+}
+
+static int myTask(void) {
+ OS_BEGIN;	
+  ...
+  OS_SIGNAL_EVENT( myEvent );
+  ...
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_SIGNAL_EVENT(pEvent) OS_SIGNAL_EVENT_(pEvent)
+#define OS_SIGNAL_EVENT_(pEvent)	do {\
+								os_signal_event(pEvent);\
+								os_event_set_signaling_tid( pEvent, running_tid );\
+								OS_SCHEDULE;\
+								} while (0)
+
+
+
+/*********************************************************************************/
+/*  OS_INT_SIGNAL_EVENT(pEvent)                                                 *//**
+*   
+*   Macro for signalling an event from an ISR. The signal is posted with
+*   os_int_signal_event() and the waiting tasks are woken by the scheduler.
+*
+*		@param pEvent Pointer to an event.
+*       
+*
+*		@remarks \b Usage: @n 
+* @code 
+os_event_type* myEvent;
+main() {
+ ...
+ evRxChar = os_create_event();
+ ...
+}
+
+ISR (SIG_UART_RECV)
+{
+	rx.data[ rx.head ] = UDR;
+	OS_INT_SIGNAL_EVENT( evRxChar );
+	
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_INT_SIGNAL_EVENT(pEvent) OS_INT_SIGNAL_EVENT_(pEvent)
+#define OS_INT_SIGNAL_EVENT_(pEvent)	do {\
+									os_int_signal_event(pEvent);\
+									} while (0)
+
+
+/* Node linking a waiting task into the waiter list of an event. Each task
+has OS_MAX_WAIT_EVENTS of them, one per event it can wait for at a time. */
+typedef struct event_waiter {
+		struct event_waiter *next;
+		struct event_waiter *prev;
+		struct event *event;
+		os_tid_t tid;
+		} os_event_waiter;
+
+/* Event type. The layout is only public so that events can be allocated
+statically for os_create_event_static(). */
+typedef struct event {
+		os_event_id id;
+		os_tid_t signaledByTid;
+		os_event_waiter *waiters;
+		} os_event_type;
+
+
+
+os_event_type* os_create_event( void );
+os_event_type* os_create_event_static( os_event_type *storage );
+os_event_id os_event_pool_high_water( void );
+uint8_t os_wait_event( os_tid_t tid, os_event_type *ev, uint8_t waitSingleEvent );
+uint8_t os_wait_multiple( uint8_t waitAll, ...);
+void os_signal_event( os_event_type *ev );
+void os_event_set_signaling_tid( os_event_type *ev, os_tid_t tid );
+os_tid_t os_event_get_signaling_tid( os_event_type *ev );
+
+
+#endif
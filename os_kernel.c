@@ -1,135 +1,514 @@
-/*
-***************************************************************************************
-***************************************************************************************
-***
-***     File: os_kernel.c
-***
-***     Project: cocoOS
-***
-***     Author: Peter Eckstrand
-***
-***************************************************************************************
-***************************************************************************************
-
-
-    Version: 1.0.0
-
-    Change log:
-    2009-07-06: 1.0.0 First release
-
-
-***************************************************************************************
-*/
-
-
-#include <io.h>
-#include <interrupt.h>
-#include <inttypes.h>
-#include "cocoos.h"
-
-
-
-/*********************************************************************************/
-/*  void os_init()                                              *//**
-*   
-*   Initializes the scheduler.
-*
-*		@return None.
-*
-*		@remarks \b Usage: @n Should be called early in system setup, before starting the task 
-*       execution
-*	
-*		
-*       @code
-int main(void) {
-	system_init();
-	os_init();
-	...
-}
-*		@endcode
-*       
-*		 */
-/*********************************************************************************/
-void os_init( void ) {
-	running_tid = NO_TID;
-}
-
-
-
-
-void os_schedule( void ) {
-	taskproctype taskproc;
-
-    /* Find the highest prio task ready to run */
-	running_tid = os_task_highest_prio_ready_task();
-	
-	if ( running_tid != NO_TID) {
-        taskproc = os_task_taskproc_get( running_tid );
-		taskproc();
-	}
-}
-
-
-
-
-/*********************************************************************************/
-/*  void os_start()                                              *//**
-*   
-*   Starts the task scheduling
-*
-*
-*		@return None.
-*
-*		@remarks \b Usage: @n Should be the last line of main.
-*
-*	
-*		
-*       @code
-int main(void) {
-	system_init();
-	os_init();
-	os_create_task( myTaskProc, 1 );
-	...
-	os_start();
-	return 0;
-}
-*		@endcode
-*       
-*/
-/*********************************************************************************/
-void os_start( void ) {
-	enable_interrupts();
-	running_tid = NO_TID;
-	for (;;){
-		os_schedule();
-	}
-}
-
-
-
-/*********************************************************************************/
-/*  void os_tick()                                              *//**
-*   
-*   Tick function driving the kernel
-*
-*
-*		@return None.
-*
-*		@remarks \b Usage: @n Should be called periodically. Preferably from the clock tick ISR.
-*
-*	
-*		
-*
-*       @code
-ISR(SIG_OVERFLOW0) {
-	...
-    os_tick();	
-}
-*		@endcode
-*       
-*/
-/*********************************************************************************/
-void os_tick( void ) {
-    os_task_tick();
-}
-
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_kernel.c
+***
+***     Project: cocoOS
+***
+***     Author: Peter Eckstrand
+***
+***************************************************************************************
+***************************************************************************************
+
+
+    Version: 1.0.0
+
+    Change log:
+    2009-07-06: 1.0.0 First release
+
+
+***************************************************************************************
+*/
+
+
+#include <inttypes.h>
+#include "cocoos.h"
+
+
+/* Task currently running, one per scheduler thread with OS_SMP */
+OS_THREAD_LOCAL os_tid_t running_tid;
+
+#if !defined( OS_SMP )
+/* Ticks and event signals posted by ISRs, applied by the scheduler before each
+dispatch. Each counter is written by one side only: intTicks, intTicksLost and
+intEventHead by the ISRs, intTicksDone and intEventTail by the scheduler. The
+tick counters are as wide as the cpu stores in one access. */
+static os_port_word intTicks;
+static os_port_word intTicksDone;
+static os_port_word intTicksLost;
+static os_event_type *intEvents[ OS_INT_QUEUE_SIZE ];
+static uint8_t intEventHead;
+static uint8_t intEventTail;
+#endif
+
+#if defined( OS_IRQ_STATS )
+/* Nesting depth and start of the current critical section, and the longest
+one since the previous os_irq_off_max() */
+static uint8_t irqOffDepth;
+static uint32_t irqOffStart;
+static uint32_t irqOffMax;
+#endif
+
+#if defined( OS_TASK_STATS )
+/* Idle time and start of the current os_cpu_load() window */
+static uint32_t idleTime;
+static uint32_t loadWindowStart;
+#endif
+
+
+/*********************************************************************************/
+/*  void os_init()                                              *//**
+*   
+*   Initializes the scheduler.
+*
+*		@return None.
+*
+*		@remarks \b Usage: @n Should be called early in system setup, before starting the task 
+*       execution
+*	
+*		
+*       @code
+int main(void) {
+	system_init();
+	os_init();
+	...
+}
+*		@endcode
+*       
+*		 */
+/*********************************************************************************/
+void os_init( void ) {
+	os_port_init();
+	running_tid = NO_TID;
+#if defined( OS_TASK_STATS )
+	loadWindowStart = os_port_timestamp();
+#endif
+}
+
+
+
+
+#if defined( OS_TICKLESS )
+/* Returns 1 if ISRs posted ticks or event signals not yet applied */
+static uint8_t int_pending( void ) {
+#if defined( OS_SMP )
+	return 0;
+#else
+	return ( os_ring_load_acquire( intTicks ) != intTicksDone ) ||
+	       ( os_ring_load_acquire( intEventHead ) != intEventTail );
+#endif
+}
+#endif
+
+
+#if !defined( OS_SMP )
+
+/* Applies what the ISRs posted, with interrupts enabled between the single
+ticks and signals */
+static void int_drain( void ) {
+	os_event_type *ev;
+
+	while ( os_ring_load_acquire( intTicks ) != intTicksDone ) {
+		os_tick();
+		os_ring_store_release( intTicksDone, (os_port_word)( intTicksDone + 1 ) );
+	}
+
+	while ( os_ring_load_acquire( intEventHead ) != intEventTail ) {
+		/* A slot is claimed before it is written, an ISR interrupted in
+		between is left for the next call */
+		ev = os_ring_load_acquire( intEvents[ intEventTail & ( OS_INT_QUEUE_SIZE - 1 ) ] );
+		if ( ev == 0 ) {
+			break;
+		}
+		intEvents[ intEventTail & ( OS_INT_QUEUE_SIZE - 1 ) ] = 0;
+		os_ring_store_release( intEventTail, (uint8_t)( intEventTail + 1 ) );
+		os_signal_event( ev );
+	}
+}
+#endif
+
+
+/* Runs the highest prio ready task once, returns its tid or NO_TID if no
+task was ready */
+os_tid_t os_schedule( void ) {
+	taskproctype taskproc;
+	os_tid_t tid;
+#if defined( OS_TASK_STATS )
+	uint32_t start;
+#endif
+
+#if !defined( OS_SMP )
+	int_drain();
+#endif
+
+    /* Find the highest prio task ready to run */
+	tid = os_task_highest_prio_ready_task();
+	running_tid = tid;
+	
+	if ( tid != NO_TID) {
+        taskproc = os_task_taskproc_get( tid );
+		os_task_dispatch( tid );
+		OS_TRACE_RECORD( OS_TRACE_TASK_IN, tid, 0 );
+#if defined( OS_TASK_STATS )
+		start = os_task_run_begin( tid );
+		taskproc();
+		os_task_run_end( tid, start );
+#else
+		taskproc();
+#endif
+		os_task_rotate( tid );
+		OS_TRACE_RECORD( OS_TRACE_TASK_OUT, tid, 0 );
+	}
+	return tid;
+}
+
+
+
+
+/*********************************************************************************/
+/*  void os_start()                                              *//**
+*   
+*   Starts the task scheduling
+*
+*
+*		@return None.
+*
+*		@remarks \b Usage: @n Should be the last line of main.
+*
+*	
+*		
+*       @code
+int main(void) {
+	system_init();
+	os_init();
+	os_create_task( myTaskProc, 1 );
+	...
+	os_start();
+	return 0;
+}
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+#if defined( OS_SMP )
+void os_start( void ) {
+	/* The workers run the scheduler, os_smp_start() does not return */
+	os_smp_start( OS_SMP_MAX_WORKERS );
+}
+#else
+void os_start( void ) {
+#if defined( OS_TICKLESS ) || defined( OS_TASK_STATS )
+	os_tid_t tid;
+#endif
+#if defined( OS_TICKLESS )
+	uint16_t ticks;
+	uint16_t timerTicks;
+#endif
+#if defined( OS_TASK_STATS )
+	uint32_t passStart;
+	uint32_t now;
+#endif
+	enable_interrupts();
+	running_tid = NO_TID;
+#if defined( OS_TASK_STATS )
+	passStart = os_port_timestamp();
+#endif
+	for (;;){
+#if defined( OS_TICKLESS ) || defined( OS_TASK_STATS )
+		tid = os_schedule();
+#else
+		os_schedule();
+#endif
+
+#ifdef OS_TICKLESS
+		/* Nothing to run, sleep until the next deadline or interrupt. The check
+		and the sleep must not be separated by an interrupt making a task ready. */
+		if ( tid == NO_TID ) {
+			disable_interrupts();
+			if ( ( os_task_highest_prio_ready_task() == NO_TID ) && !int_pending() ) {
+				ticks = os_task_next_wakeup();
+				timerTicks = os_timer_next_expiry();
+				if ( ( timerTicks != 0 ) && ( ( ticks == 0 ) || ( timerTicks < ticks ) ) ) {
+					ticks = timerTicks;
+				}
+				ticks = os_idle( ticks );
+				os_task_tick_n( ticks );
+				os_timer_tick_n( ticks );
+			}
+			enable_interrupts();
+		}
+#endif
+
+#if defined( OS_TASK_STATS )
+		/* A pass of the loop that found no task to run counts as idle time as a
+		whole, including the sleep and the bookkeeping */
+		now = os_port_timestamp();
+		if ( tid == NO_TID ) {
+			os_cpu_idle_add( now - passStart );
+		}
+		passStart = now;
+#endif
+	}
+}
+#endif
+
+
+
+/*********************************************************************************/
+/*  void os_tick()                                              *//**
+*   
+*   Tick function driving the kernel
+*
+*
+*		@return None.
+*
+*		@remarks \b Usage: @n Should be called periodically. The tick is applied
+*       at once, with the sleeping tasks and timers due handled with interrupts
+*       disabled, so a clock ISR should rather call os_int_tick().
+*
+*	
+*		
+*
+*       @code
+static int clockTask(void) {
+	OS_BEGIN;
+	for (;;) {
+		OS_WAIT_SINGLE_EVENT( clockEvent );
+		os_tick();
+	}
+	OS_END;
+	return 0;
+}
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+void os_tick( void ) {
+	OS_TRACE_RECORD( OS_TRACE_TICK, NO_TID, 0 );
+    os_task_tick();
+    os_timer_tick();
+}
+
+
+/*********************************************************************************/
+/*  void os_int_tick()                                              *//**
+*   
+*   Tick function for the clock ISR. The tick is only counted, the scheduler
+*   applies it before the next dispatch, so the time the ISR runs and keeps
+*   interrupts disabled does not depend on the number of tasks and timers.
+*
+*		@return None.
+*
+*       @code
+ISR(SIG_OVERFLOW0) {
+	...
+    os_int_tick();	
+}
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+void os_int_tick( void ) {
+#if defined( OS_SMP )
+	os_tick();
+#else
+	/* A backlog as large as the counter holds can not grow, the tick is
+	counted as lost instead */
+	if ( (os_port_word)( intTicks - os_ring_load_acquire( intTicksDone ) ) != (os_port_word)~0 ) {
+		os_ring_store_release( intTicks, (os_port_word)( intTicks + 1 ) );
+	}
+	else {
+		os_ring_store_release( intTicksLost, (os_port_word)( intTicksLost + 1 ) );
+	}
+#endif
+}
+
+
+/* Returns the number of ticks dropped by os_int_tick() because the scheduler
+had not applied the earlier ones for as many ticks as its counter holds, 255
+on AVR. A task running that long blocks the scheduler anyway. */
+uint32_t os_int_ticks_lost( void ) {
+#if defined( OS_SMP )
+	return 0;
+#else
+	return os_ring_load_acquire( intTicksLost );
+#endif
+}
+
+
+/*********************************************************************************/
+/*  void os_int_signal_event()                                              *//**
+*   
+*   Signals an event from an ISR. The signal is posted to a queue of
+*   OS_INT_QUEUE_SIZE entries without disabling interrupts, and the scheduler
+*   wakes the waiting tasks before the next dispatch. When the queue is full
+*   the event is signaled at once, as with os_signal_event().
+*
+*		@param ev Pointer to the event.
+*
+*		@return None.
+*
+*       @code
+ISR (SIG_UART_RECV)
+{
+	...
+	os_int_signal_event( rxEvent );
+}
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+void os_int_signal_event( os_event_type *ev ) {
+#if defined( OS_SMP )
+	os_signal_event( ev );
+#else
+	uint8_t head;
+
+	/* AVR interrupts do not nest, but Linux signal handlers of different
+	signals may interrupt each other, so there the slot is claimed atomically */
+#if defined( __GNUC__ ) && !defined( OS_PORT_AVR )
+	head = os_ring_load_acquire( intEventHead );
+	do {
+		if ( (uint8_t)( head - os_ring_load_acquire( intEventTail ) ) == OS_INT_QUEUE_SIZE ) {
+			os_signal_event( ev );
+			return;
+		}
+	} while ( !__atomic_compare_exchange_n( &intEventHead, &head, (uint8_t)( head + 1 ), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) );
+#else
+	head = intEventHead;
+	if ( (uint8_t)( head - os_ring_load_acquire( intEventTail ) ) == OS_INT_QUEUE_SIZE ) {
+		os_signal_event( ev );
+		return;
+	}
+	intEventHead = head + 1;
+#endif
+	os_ring_store_release( intEvents[ head & ( OS_INT_QUEUE_SIZE - 1 ) ], ev );
+#endif
+}
+
+
+#if defined( OS_IRQ_STATS )
+/* Called on entering a critical section, with interrupts already disabled */
+void os_irq_off_begin( void ) {
+	if ( irqOffDepth++ == 0 ) {
+		irqOffStart = os_port_timestamp();
+	}
+}
+
+
+/* Called on leaving a critical section, before interrupts are enabled */
+void os_irq_off_end( void ) {
+	uint32_t length;
+	if ( --irqOffDepth == 0 ) {
+		length = os_port_timestamp() - irqOffStart;
+		if ( length > irqOffMax ) {
+			irqOffMax = length;
+		}
+	}
+}
+
+
+/*********************************************************************************/
+/*  uint32_t os_irq_off_max()                                              *//**
+*   
+*   Returns the longest time the kernel kept interrupts disabled in a critical
+*   section since the previous call. Only available when the kernel is built
+*   with OS_IRQ_STATS defined.
+*
+*		@return Time in port timestamp units, see os_port_timestamp_hz().
+*
+*/
+/*********************************************************************************/
+uint32_t os_irq_off_max( void ) {
+	uint32_t length;
+	os_cpu_sr sr;
+	OS_PORT_ENTER_CRITICAL( sr );
+	length = irqOffMax;
+	irqOffMax = 0;
+	OS_PORT_EXIT_CRITICAL( sr );
+	return length;
+}
+#endif
+
+
+/*********************************************************************************/
+/*  uint32_t os_tick_count()                                              *//**
+*   
+*   Returns the number of ticks since the system started. The count wraps
+*   around, so compare two counts on their difference.
+*
+*		@return Number of ticks.
+*
+*/
+/*********************************************************************************/
+uint32_t os_tick_count( void ) {
+	return os_task_tick_count();
+}
+
+
+
+#if defined( OS_TASK_STATS )
+/* Adds time spent by a scheduler loop without any task to run */
+void os_cpu_idle_add( uint32_t time ) {
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+	idleTime += time;
+	os_exit_critical( sr );
+}
+
+
+/*********************************************************************************/
+/*  uint8_t os_cpu_load()                                              *//**
+*   
+*   Returns the cpu load since the previous call, computed from the time the
+*   scheduler loop found no task to run. Only available when the kernel is
+*   built with OS_TASK_STATS defined.
+*
+*		@return Cpu load in percent, the idle percentage is 100 minus the load.
+*       With OS_SMP it is the average over the worker threads.
+*
+*		@remarks \b Usage: @n Call periodically, e.g. once a second from a low
+*       priority task. The period must be shorter than the wrap around time of
+*       the port timestamp, 4.29 s on Linux.
+*
+*       @code
+static int monitorTask(void) {
+	OS_BEGIN;
+	for (;;) {
+		OS_WAIT_TICKS( 1000 );
+		load = os_cpu_load();
+	}
+	OS_END;
+	return 0;
+}
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+uint8_t os_cpu_load( void ) {
+	uint32_t now;
+	uint32_t elapsed;
+	uint32_t idle;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	now = os_port_timestamp();
+	elapsed = now - loadWindowStart;
+	idle = idleTime;
+	loadWindowStart = now;
+	idleTime = 0;
+
+	os_exit_critical( sr );
+
+#if defined( OS_SMP )
+	idle /= os_smp_workers();
+#endif
+
+	if ( elapsed < 100 ) {
+		return 0;
+	}
+	idle /= elapsed / 100;
+	return ( idle >= 100 ) ? 0 : (uint8_t)( 100 - idle );
+}
+#endif
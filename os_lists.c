@@ -1,104 +1,167 @@
-/*
-***************************************************************************************
-***************************************************************************************
-***
-***     File: os_lists.c
-***
-***     Project: cocoOS
-***
-***     Author: Peter Eckstrand
-***
-***************************************************************************************
-***************************************************************************************
-
-
-    Version: 1.0.0
-
-    Change log:
-    2009-07-06: 1.0.0 First release
-
-
-***************************************************************************************
-*/
-
-#include <inttypes.h>
-#include <interrupt.h>
-#include "cocoos.h"
-
-
-/* list_add(): Adds the tid to the list. It is assumed that the tid is not
-in the list already */
-void list_add(uint8_t tid,uint8_t *list) {
-	uint8_t index = 0;
-	disable_interrupts();
-
-	/* Find an empty position in list */
-	for ( index = 0; index < MAX_TASKS; ++index ) {
-		if ( list[ index ] == NO_TID ) {
-			list[ index ] = tid;
-			break;
-		}
-	}
-	
-   enable_interrupts();
-}
-
-
-void list_remove(uint8_t tid,uint8_t *list) {
-	uint8_t index;
-	disable_interrupts();
-	for (index=0;index<MAX_TASKS;index++)
-	{
-		if (list[index]==tid)
-			list[index]=NO_TID;
-		
-	}
-	enable_interrupts();
-}
-
-
-uint8_t list_tid_in_list( uint8_t tid, uint8_t *list) {
-	uint8_t index;
-	for ( index = 0; index < MAX_TASKS; ++index ) {
-		if ( list[ index ] == tid ) {
-			return 1;
-		}
-	}
-	return 0;
-}
-
-
-uint8_t list_is_empty(uint8_t *list) {
-   uint8_t index;
-   uint8_t nr_empty=0;
-   for (index=0;index<MAX_TASKS;index++)
-      if (list[index]==NO_TID)
-	     nr_empty++;
-   if (nr_empty==MAX_TASKS)
-      return 1;
-   else
-      return 0;
-}
-
-void list_move_highest_prio_to_ready(uint8_t *list) {
-	uint8_t highest_prio=255;
-	uint8_t index;
-	uint8_t tid = 0;
-    uint8_t taskPrio = 0;
-	for (index=0;index<MAX_TASKS;index++) {
-		if (list[index]!=NO_TID) {
-            taskPrio = os_task_prio_get( list[ index ] );
-			if ( taskPrio < highest_prio ) {
-				tid = list[ index ];
-				highest_prio = taskPrio;
-			}
-		}
-	}
-
-	if (highest_prio != 255) {
-		list_remove(tid,list);
-        os_task_ready_set( tid );
-	}
-}
-
-
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_lists.c
+***
+***     Project: cocoOS
+***
+***     Author: Peter Eckstrand
+***
+***************************************************************************************
+***************************************************************************************
+
+
+    Version: 1.0.0
+
+    Change log:
+    2009-07-06: 1.0.0 First release
+
+
+***************************************************************************************
+*/
+
+#include <inttypes.h>
+#include "cocoos.h"
+
+
+/* Links of the tasks in the wait lists, indexed by tid. waitIn is the list the
+task is in, 0 if none. */
+static os_tid_t waitNext[ MAX_TASKS ];
+static os_tid_t waitPrev[ MAX_TASKS ];
+static os_wait_list *waitIn[ MAX_TASKS ];
+
+
+static void list_unlink( os_tid_t tid ) {
+	os_wait_list *list = waitIn[ tid ];
+
+	if ( waitPrev[ tid ] != NO_TID ) {
+		waitNext[ waitPrev[ tid ] ] = waitNext[ tid ];
+	}
+	else {
+		list->head = waitNext[ tid ];
+	}
+
+	if ( waitNext[ tid ] != NO_TID ) {
+		waitPrev[ waitNext[ tid ] ] = waitPrev[ tid ];
+	}
+	else {
+		list->tail = waitPrev[ tid ];
+	}
+	waitIn[ tid ] = 0;
+}
+
+
+void list_init( os_wait_list *list ) {
+	list->head = NO_TID;
+	list->tail = NO_TID;
+}
+
+
+/* list_add(): Adds the tid to the list, behind the tasks of the same or
+higher priority. The list is searched from the tail, past the tasks of lower
+priority, so adding is O(1) when the waiters share a priority and O(n) in the
+worst case. A task already in a list is moved. */
+void list_add( os_tid_t tid, os_wait_list *list ) {
+	os_tid_t prev;
+	uint8_t prio;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	if ( waitIn[ tid ] != 0 ) {
+		list_unlink( tid );
+	}
+
+	prio = os_task_prio_get( tid );
+	prev = list->tail;
+	while ( ( prev != NO_TID ) && ( os_task_prio_get( prev ) > prio ) ) {
+		prev = waitPrev[ prev ];
+	}
+
+	waitPrev[ tid ] = prev;
+	if ( prev != NO_TID ) {
+		waitNext[ tid ] = waitNext[ prev ];
+		waitNext[ prev ] = tid;
+	}
+	else {
+		waitNext[ tid ] = list->head;
+		list->head = tid;
+	}
+
+	if ( waitNext[ tid ] != NO_TID ) {
+		waitPrev[ waitNext[ tid ] ] = tid;
+	}
+	else {
+		list->tail = tid;
+	}
+	waitIn[ tid ] = list;
+
+	os_exit_critical( sr );
+}
+
+
+void list_remove( os_tid_t tid, os_wait_list *list ) {
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+	if ( ( list != 0 ) && ( waitIn[ tid ] == list ) ) {
+		list_unlink( tid );
+	}
+	os_exit_critical( sr );
+}
+
+
+uint8_t list_tid_in_list( os_tid_t tid, os_wait_list *list ) {
+	return ( waitIn[ tid ] == list );
+}
+
+
+uint8_t list_is_empty( os_wait_list *list ) {
+	return ( list->head == NO_TID );
+}
+
+
+/* Returns the highest prio task in the list, NO_TID if the list is empty */
+os_tid_t list_head( os_wait_list *list ) {
+	return list->head;
+}
+
+
+/* Makes the highest prio task in the list ready and returns its tid, NO_TID
+if the list is empty */
+os_tid_t list_move_highest_prio_to_ready( os_wait_list *list ) {
+	os_tid_t tid;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	tid = list->head;
+	if ( tid != NO_TID ) {
+		list_unlink( tid );
+		os_task_ready_set( tid );
+	}
+
+	os_exit_critical( sr );
+	return tid;
+}
+
+
+/* Returns the list the task is pending in, 0 if none */
+os_wait_list* list_waiting_in( os_tid_t tid ) {
+	return waitIn[ tid ];
+}
+
+
+/* Moves a waiting task to its place for a changed priority */
+void list_prio_changed( os_tid_t tid ) {
+	os_wait_list *list;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	list = waitIn[ tid ];
+	if ( list != 0 ) {
+		list_add( tid, list );
+	}
+
+	os_exit_critical( sr );
+}
+
+
@@ -1,15 +1,26 @@
-#ifndef OS_LISTS_H
-#define OS_LISTS_H
-
-#include "os_defines.h"
-
-
-void list_add(uint8_t tid,uint8_t *list);
-void list_remove(uint8_t tid,uint8_t *list);
-uint8_t list_tid_in_list( uint8_t tid, uint8_t *list);
-uint8_t list_is_empty(uint8_t *list);
-void list_move_highest_prio_to_ready(uint8_t *list);
-void list_set_task_wait_event( uint8_t tid, uint8_t id, uint8_t waitSingleEvent );
-void list_clear_wait_event( uint8_t tid, uint8_t id );
-
-#endif
+#ifndef OS_LISTS_H
+#define OS_LISTS_H
+
+#include "os_defines.h"
+
+/* List of the tasks pending on a semaphore, mutex or message queue. The tasks
+are linked through links kept per task in os_lists.c, sorted on priority and
+in FIFO order within a priority, so the head is the task to wake next. A task
+is in at most one list at a time. */
+typedef struct {
+		os_tid_t head;
+		os_tid_t tail;
+		} os_wait_list;
+
+
+void list_init( os_wait_list *list );
+void list_add( os_tid_t tid, os_wait_list *list );
+void list_remove( os_tid_t tid, os_wait_list *list );
+uint8_t list_tid_in_list( os_tid_t tid, os_wait_list *list );
+uint8_t list_is_empty( os_wait_list *list );
+os_tid_t list_head( os_wait_list *list );
+os_tid_t list_move_highest_prio_to_ready( os_wait_list *list );
+os_wait_list* list_waiting_in( os_tid_t tid );
+void list_prio_changed( os_tid_t tid );
+
+#endif
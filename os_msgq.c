@@ -0,0 +1,403 @@
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_msgq.c
+***
+***     Project: cocoOS
+***
+***************************************************************************************
+***************************************************************************************
+*/
+
+
+#include <inttypes.h>
+#include "cocoos.h"
+#include "os_msgq.h"
+
+#if OS_MSGQ_POOL_SIZE > 0
+static os_msgq_type msgq_pool[ OS_MSGQ_POOL_SIZE ];
+#endif
+static uint8_t nPoolMsgqs = 0;
+
+
+/*********************************************************************************/
+/*  os_msgq_type* os_create_msgq()                                              *//**
+*   
+*   Creates a message queue, taken from a static pool of OS_MSGQ_POOL_SIZE queues.
+*
+*		@param buffer Storage for the messages, at least msgSize * capacity bytes.
+*
+*		@param msgSize Size of one message in bytes.
+*
+*		@param capacity Number of message slots in the queue, at most
+*       OS_MSGQ_MAX_SLOTS.
+*
+*		@return Returns a pointer to the created queue, or 0 if the pool is
+*       exhausted or capacity is out of range.
+*
+*		@remarks \b Usage: @n A queue is created by declaring a variable of type os_msgq_type* and then
+*		assigning the os_create_msgq() return value to that variable.
+*	
+*		
+*       @code
+*       static myMsg_t buffer[ 8 ];
+*       os_msgq_type* myQueue;
+*       myQueue = os_create_msgq( buffer, sizeof( myMsg_t ), 8 );
+*		@endcode
+*       
+*		 */
+/*********************************************************************************/
+os_msgq_type* os_create_msgq( void *buffer, uint8_t msgSize, uint8_t capacity ) {
+#if OS_MSGQ_POOL_SIZE > 0
+	if ( ( nPoolMsgqs != OS_MSGQ_POOL_SIZE ) && ( capacity != 0 ) && ( capacity <= OS_MSGQ_MAX_SLOTS ) ) {
+		return os_create_msgq_static( &msgq_pool[ nPoolMsgqs++ ], buffer, msgSize, capacity );
+	}
+#endif
+	return 0;
+}
+
+
+/*********************************************************************************/
+/*  os_msgq_type* os_create_msgq_static()                                              *//**
+*   
+*   Initializes a message queue in storage provided by the caller.
+*
+*		@param storage Pointer to the queue to initialize.
+*
+*		@param buffer Storage for the messages, at least msgSize * capacity bytes.
+*
+*		@param msgSize Size of one message in bytes.
+*
+*		@param capacity Number of message slots in the queue, at most
+*       OS_MSGQ_MAX_SLOTS.
+*
+*		@return Returns storage, or 0 if capacity is out of range.
+*       
+*		 */
+/*********************************************************************************/
+os_msgq_type* os_create_msgq_static( os_msgq_type *storage, void *buffer, uint8_t msgSize, uint8_t capacity ) {
+	if ( ( capacity == 0 ) || ( capacity > OS_MSGQ_MAX_SLOTS ) ) {
+		return 0;
+	}
+	storage->buffer = (uint8_t*)buffer;
+	storage->msgSize = msgSize;
+	storage->capacity = capacity;
+	storage->head = 0;
+	storage->count = 0;
+	storage->reserved = 0;
+	storage->receiving = 0;
+	memset( storage->done, 0, sizeof( storage->done ) );
+	memset( storage->skip, 0, sizeof( storage->skip ) );
+
+	list_init( &storage->post_waiting_tasks );
+	list_init( &storage->receive_waiting_tasks );
+
+	return storage;
+}
+
+
+/* The slots of a queue are used in ring order. From the head on there are
+first the slots handed to receivers, then the published messages not yet
+received, then the reserved slots. Commits and releases may come in any
+order, so a slot committed or released ahead of an older one only gets its
+done bit set, and the counters move past a slot once its bit is set. A slot
+is in one region at a time, so one bit per slot covers both. A reservation
+given up without a commit is published with its skip bit set, and receivers
+pass over it. */
+
+/* Per task: the slot it reserved and has not committed yet, and the slot it
+received and has not released yet, when taken with the waiting variants.
+They are given back when the task is deleted or restarted. */
+static os_msgq_type *reservedQueue[ MAX_TASKS ];
+static void *reservedSlot[ MAX_TASKS ];
+static os_msgq_type *receivedQueue[ MAX_TASKS ];
+static void *receivedSlot[ MAX_TASKS ];
+
+
+/* Returns the index of the slot the given number of slots after the head */
+static uint8_t msgq_index( os_msgq_type *queue, uint8_t offset ) {
+	uint16_t index = (uint16_t)queue->head + offset;
+	if ( index >= queue->capacity ) {
+		index -= queue->capacity;
+	}
+	return (uint8_t)index;
+}
+
+
+/* Returns the number of slots from the head to the given slot */
+static uint8_t msgq_offset( os_msgq_type *queue, void *slot ) {
+	uint16_t index = (uint16_t)( ( (uint8_t*)slot - queue->buffer ) / queue->msgSize );
+	if ( index < queue->head ) {
+		index += queue->capacity;
+	}
+	return (uint8_t)( index - queue->head );
+}
+
+
+static uint8_t msgq_bit_get( const uint8_t *bits, uint8_t index ) {
+	return ( bits[ index >> 3 ] >> ( index & 7 ) ) & 1;
+}
+
+
+static void msgq_bit_set( uint8_t *bits, uint8_t index ) {
+	bits[ index >> 3 ] |= (uint8_t)( 1 << ( index & 7 ) );
+}
+
+
+static void msgq_bit_clear( uint8_t *bits, uint8_t index ) {
+	bits[ index >> 3 ] &= (uint8_t)~( 1 << ( index & 7 ) );
+}
+
+
+/* Publishes the committed slots at the front of the reserved ones, waking a
+task waiting to receive for each real message */
+static void msgq_publish( os_msgq_type *queue ) {
+	uint8_t index = msgq_index( queue, queue->count );
+
+	while ( ( queue->reserved != 0 ) && msgq_bit_get( queue->done, index ) ) {
+		msgq_bit_clear( queue->done, index );
+		--queue->reserved;
+		++queue->count;
+		if ( !msgq_bit_get( queue->skip, index ) && !list_is_empty( &queue->receive_waiting_tasks ) ) {
+			list_move_highest_prio_to_ready( &queue->receive_waiting_tasks );
+		}
+		index = msgq_index( queue, queue->count );
+	}
+}
+
+
+/* Frees the released slots at the head, waking a task waiting to post for
+each */
+static void msgq_free( os_msgq_type *queue ) {
+	while ( ( queue->receiving != 0 ) && msgq_bit_get( queue->done, queue->head ) ) {
+		msgq_bit_clear( queue->done, queue->head );
+		--queue->receiving;
+		--queue->count;
+		if ( ++queue->head == queue->capacity ) {
+			queue->head = 0;
+		}
+		if ( !list_is_empty( &queue->post_waiting_tasks ) ) {
+			list_move_highest_prio_to_ready( &queue->post_waiting_tasks );
+		}
+	}
+}
+
+
+/* Marks a reserved slot done, with its skip bit set if the reservation is
+given up, and publishes what can be published */
+static void msgq_commit( os_msgq_type *queue, void *slot, uint8_t skip ) {
+	uint8_t offset = msgq_offset( queue, slot );
+	uint8_t index;
+
+	if ( ( offset >= queue->count ) && ( offset - queue->count < queue->reserved ) ) {
+		index = msgq_index( queue, offset );
+		msgq_bit_set( queue->done, index );
+		if ( skip ) {
+			msgq_bit_set( queue->skip, index );
+		}
+		msgq_publish( queue );
+	}
+}
+
+
+/* Marks a received slot done and frees what can be freed */
+static void msgq_release( os_msgq_type *queue, void *slot ) {
+	uint8_t offset = msgq_offset( queue, slot );
+
+	if ( offset < queue->receiving ) {
+		msgq_bit_set( queue->done, msgq_index( queue, offset ) );
+		msgq_free( queue );
+	}
+}
+
+
+/* Reserves the first free slot behind the committed and reserved messages.
+Returns 0 if the queue is full. Can be called from an ISR. */
+void* os_msg_reserve( os_msgq_type *queue ) {
+	void *slot = 0;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	if ( queue->count + queue->reserved < queue->capacity ) {
+		slot = queue->buffer + msgq_index( queue, queue->count + queue->reserved ) * queue->msgSize;
+		++queue->reserved;
+	}
+
+	os_exit_critical( sr );
+	return slot;
+}
+
+
+/* As os_msg_reserve(), but if the queue is full the task is put in the post
+wait list in the same critical section, so a slot freed in between is not missed. */
+void* os_msg_reserve_wait( os_msgq_type *queue, os_tid_t tid ) {
+	void *slot;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	slot = os_msg_reserve( queue );
+	if ( slot != 0 ) {
+		reservedQueue[ tid ] = queue;
+		reservedSlot[ tid ] = slot;
+	}
+	else {
+		os_task_pending_set( tid );
+		list_add( tid, &queue->post_waiting_tasks );
+	}
+
+	os_exit_critical( sr );
+	return slot;
+}
+
+
+/* Marks a reserved slot as committed. The messages are published in the order
+their slots were reserved, so the slot is published together with the ones
+behind it once all older reservations are committed. A task waiting to
+receive is woken for each message published. Can be called from an ISR. */
+void os_msg_commit( os_msgq_type *queue, void *slot ) {
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	if ( ( running_tid != NO_TID ) && ( reservedSlot[ running_tid ] == slot ) ) {
+		reservedSlot[ running_tid ] = 0;
+	}
+	msgq_commit( queue, slot, 0 );
+
+	os_exit_critical( sr );
+}
+
+
+/*********************************************************************************/
+/*  uint8_t os_msg_int_post()                                              *//**
+*   
+*   Copies a message into a queue from an ISR, without waiting.
+*
+*		@param queue Pointer to a message queue.
+*
+*		@param msg Pointer to the message.
+*
+*		@return Returns 1 if the message was posted, 0 if the queue was full.
+*
+*		@remarks \b Usage: @n If a task has a slot of the queue reserved, the
+*       message is received after the one of the task.
+*       @code
+ISR (SIG_UART_RECV)
+{
+	uint8_t c = UDR;
+	os_msg_int_post( rxQueue, &c );
+}
+*		@endcode
+*       
+*		 */
+/*********************************************************************************/
+uint8_t os_msg_int_post( os_msgq_type *queue, const void *msg ) {
+	void *slot = os_msg_reserve( queue );
+	os_cpu_sr sr;
+
+	if ( slot == 0 ) {
+		return 0;
+	}
+	memcpy( slot, msg, queue->msgSize );
+
+	os_enter_critical( sr );
+	msgq_commit( queue, slot, 0 );
+	os_exit_critical( sr );
+	return 1;
+}
+
+
+/* Takes the oldest message not already being received, passing over given up
+reservations. Returns 0 if there is none. The slot stays owned by the receiver
+until os_msg_release(). */
+void* os_msg_get( os_msgq_type *queue ) {
+	void *slot = 0;
+	uint8_t index;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	while ( ( slot == 0 ) && ( queue->receiving < queue->count ) ) {
+		index = msgq_index( queue, queue->receiving );
+		++queue->receiving;
+		if ( msgq_bit_get( queue->skip, index ) ) {
+			msgq_bit_clear( queue->skip, index );
+			msgq_bit_set( queue->done, index );
+			msgq_free( queue );
+		}
+		else {
+			slot = queue->buffer + index * queue->msgSize;
+		}
+	}
+
+	os_exit_critical( sr );
+	return slot;
+}
+
+
+/* As os_msg_get(), but if the queue is empty the task is put in the receive
+wait list in the same critical section, so a message posted in between is not missed. */
+void* os_msg_get_wait( os_msgq_type *queue, os_tid_t tid ) {
+	void *slot;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	slot = os_msg_get( queue );
+	if ( slot != 0 ) {
+		receivedQueue[ tid ] = queue;
+		receivedSlot[ tid ] = slot;
+	}
+	else {
+		os_task_pending_set( tid );
+		list_add( tid, &queue->receive_waiting_tasks );
+	}
+
+	os_exit_critical( sr );
+	return slot;
+}
+
+
+/* Gives a received slot back to the queue. The head moves past it once the
+older received slots are released too, and a task waiting to post is woken
+for each slot freed. */
+void os_msg_release( os_msgq_type *queue, void *slot ) {
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	if ( ( running_tid != NO_TID ) && ( receivedSlot[ running_tid ] == slot ) ) {
+		receivedSlot[ running_tid ] = 0;
+	}
+	msgq_release( queue, slot );
+
+	os_exit_critical( sr );
+}
+
+
+/* Called when a task is deleted or restarted. A slot it reserved through
+os_msg_reserve_wait() and did not commit is given up, and a slot it received
+through os_msg_get_wait() and did not release is released. */
+void os_msgq_task_cleanup( os_tid_t tid ) {
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	if ( reservedSlot[ tid ] != 0 ) {
+		msgq_commit( reservedQueue[ tid ], reservedSlot[ tid ], 1 );
+		reservedSlot[ tid ] = 0;
+	}
+	if ( receivedSlot[ tid ] != 0 ) {
+		msgq_release( receivedQueue[ tid ], receivedSlot[ tid ] );
+		receivedSlot[ tid ] = 0;
+	}
+
+	os_exit_critical( sr );
+}
+
+
+uint8_t os_msgq_get_msg_size( os_msgq_type *queue ) {
+	return queue->msgSize;
+}
+
+
+/* Returns the largest number of message queues ever taken from the pool */
+uint8_t os_msgq_pool_high_water( void ) {
+	return nPoolMsgqs;
+}
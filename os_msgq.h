@@ -0,0 +1,164 @@
+#ifndef OS_MSGQ_H
+#define OS_MSGQ_H
+
+/** @file os_msgq.h Message queue header file*/
+
+#include "cocoos.h"
+#include <string.h>
+
+
+/*********************************************************************************/
+/*  OS_MSG_RESERVE(queue, msg)                                                 *//**
+*   
+*   Macro for reserving a free message slot in a queue. The task waits until a
+*   slot is free. The message is then filled in place and published with
+*   os_msg_commit() on the same slot, so no copying is involved.
+*
+*		@param queue Pointer to a message queue.
+*		@param msg Pointer variable that is set to point to the reserved slot.
+*
+*		@remarks \b Usage: @n Local variables do not survive a yield, declare
+*       the pointer static.
+* @code 
+os_msgq_type* myQueue;
+static myMsg_t buffer[ 8 ];
+main() {
+ ...
+ myQueue = os_create_msgq( buffer, sizeof( myMsg_t ), 8 );
+ ...
+}
+
+static int myTask(void) {
+ static myMsg_t *msg;
+ OS_BEGIN;	
+  ...
+  OS_MSG_RESERVE( myQueue, msg );
+  msg->value = 17;
+  os_msg_commit( myQueue, msg );
+  ...
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_MSG_RESERVE(queue, msg)  OS_MSG_RESERVE_(queue, msg)
+#define OS_MSG_RESERVE_(queue, msg)	do {\
+								while ( ( (msg) = os_msg_reserve_wait( queue, running_tid ) ) == 0 )\
+								{\
+									OS_SCHEDULE;\
+								}\
+							   } while (0)
+
+
+/*********************************************************************************/
+/*  OS_MSG_POST(queue, msg)                                                 *//**
+*   
+*   Macro for posting a message to a queue. The task waits until a slot is
+*   free and the message is copied into it. Use OS_MSG_RESERVE() to avoid the copy.
+*
+*		@param queue Pointer to a message queue.
+*		@param msg Pointer to the message, must stay valid while the task waits.
+*
+*		@remarks \b Usage: @n 
+* @code 
+static int myTask(void) {
+ static myMsg_t msg;
+ OS_BEGIN;	
+  ...
+  msg.value = 17;
+  OS_MSG_POST( myQueue, &msg );
+  ...
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_MSG_POST(queue, msg)  OS_MSG_POST_(queue, msg)
+#define OS_MSG_POST_(queue, msg)	do {\
+								void *slot_;\
+								while ( ( slot_ = os_msg_reserve_wait( queue, running_tid ) ) == 0 )\
+								{\
+									OS_SCHEDULE;\
+								}\
+								memcpy( slot_, msg, os_msgq_get_msg_size( queue ) );\
+								os_msg_commit( queue, slot_ );\
+							   } while (0)
+
+
+/*********************************************************************************/
+/*  OS_MSG_RECEIVE(queue, msg)                                                 *//**
+*   
+*   Macro for receiving a message from a queue. The task waits until a message
+*   is available. The message is read in place and the slot is given back to
+*   the queue with os_msg_release() on the same slot.
+*
+*		@param queue Pointer to a message queue.
+*		@param msg Pointer variable that is set to point to the message.
+*
+*		@remarks \b Usage: @n 
+* @code 
+static int myTask(void) {
+ static myMsg_t *msg;
+ OS_BEGIN;	
+  ...
+  OS_MSG_RECEIVE( myQueue, msg );
+  handle( msg->value );
+  os_msg_release( myQueue, msg );
+  ...
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_MSG_RECEIVE(queue, msg)  OS_MSG_RECEIVE_(queue, msg)
+#define OS_MSG_RECEIVE_(queue, msg)	do {\
+								while ( ( (msg) = os_msg_get_wait( queue, running_tid ) ) == 0 )\
+								{\
+									OS_SCHEDULE;\
+								}\
+							   } while (0)
+
+
+/* Largest number of slots in a queue. Every queue keeps two bits per slot to
+track commits and releases that come out of order and reservations given up. */
+#ifndef OS_MSGQ_MAX_SLOTS
+#define OS_MSGQ_MAX_SLOTS	32
+#endif
+
+#if ( OS_MSGQ_MAX_SLOTS < 1 ) || ( OS_MSGQ_MAX_SLOTS > 255 )
+#error "OS_MSGQ_MAX_SLOTS must be between 1 and 255"
+#endif
+
+/* Message queue type. The layout is only public so that queues can be
+allocated statically for os_create_msgq_static(). */
+typedef struct msgq {
+		uint8_t *buffer;
+		uint8_t msgSize;
+		uint8_t capacity;
+		uint8_t head;
+		uint8_t count;
+		uint8_t reserved;
+		uint8_t receiving;
+		uint8_t done[ ( OS_MSGQ_MAX_SLOTS + 7 ) / 8 ];
+		uint8_t skip[ ( OS_MSGQ_MAX_SLOTS + 7 ) / 8 ];
+		os_wait_list post_waiting_tasks;
+		os_wait_list receive_waiting_tasks;
+		} os_msgq_type;
+
+
+
+os_msgq_type* os_create_msgq( void *buffer, uint8_t msgSize, uint8_t capacity );
+os_msgq_type* os_create_msgq_static( os_msgq_type *storage, void *buffer, uint8_t msgSize, uint8_t capacity );
+void* os_msg_reserve( os_msgq_type *queue );
+void* os_msg_reserve_wait( os_msgq_type *queue, os_tid_t tid );
+void os_msg_commit( os_msgq_type *queue, void *slot );
+uint8_t os_msg_int_post( os_msgq_type *queue, const void *msg );
+void* os_msg_get( os_msgq_type *queue );
+void* os_msg_get_wait( os_msgq_type *queue, os_tid_t tid );
+void os_msg_release( os_msgq_type *queue, void *slot );
+uint8_t os_msgq_get_msg_size( os_msgq_type *queue );
+uint8_t os_msgq_pool_high_water( void );
+void os_msgq_task_cleanup( os_tid_t tid );
+
+
+#endif
@@ -0,0 +1,228 @@
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_mutex.c
+***
+***     Project: cocoOS
+***
+***************************************************************************************
+***************************************************************************************
+*/
+
+
+#include <inttypes.h>
+#include "cocoos.h"
+#include "os_mutex.h"
+
+#if OS_MUTEX_POOL_SIZE > 0
+static os_mutex_type mutex_pool[ OS_MUTEX_POOL_SIZE ];
+#endif
+static uint8_t nPoolMutexes = 0;
+
+/* Per task: the mutexes it holds, linked through nextHeld, and the mutex it
+waits for. They are needed to pass an inherited priority along a chain of
+holders, and to find the priority to drop back to on unlock. */
+static os_mutex_type *heldMutexes[ MAX_TASKS ];
+static os_mutex_type *blockedOn[ MAX_TASKS ];
+
+
+/*********************************************************************************/
+/*  os_mutex_type* os_create_mutex()                                              *//**
+*   
+*   Creates an unlocked mutex, taken from a static pool of OS_MUTEX_POOL_SIZE
+*   mutexes.
+*
+*		@return Returns a pointer to the created mutex, or 0 if the pool is exhausted.
+*	
+*		
+*       @code
+*       os_mutex_type* myMutex;
+*       myMutex = os_create_mutex();
+*		@endcode
+*       
+*		 */
+/*********************************************************************************/
+os_mutex_type* os_create_mutex( void ) {
+#if OS_MUTEX_POOL_SIZE > 0
+	if ( nPoolMutexes != OS_MUTEX_POOL_SIZE ) {
+		return os_create_mutex_static( &mutex_pool[ nPoolMutexes++ ] );
+	}
+#endif
+	return 0;
+}
+
+
+/*********************************************************************************/
+/*  os_mutex_type* os_create_mutex_static()                                              *//**
+*   
+*   Initializes an unlocked mutex in storage provided by the caller.
+*
+*		@param storage Pointer to the mutex to initialize.
+*
+*		@return Returns storage.
+*	
+*		
+*       @code
+*       static os_mutex_type myMutexStorage;
+*       os_mutex_type* myMutex;
+*       myMutex = os_create_mutex_static( &myMutexStorage );
+*		@endcode
+*       
+*		 */
+/*********************************************************************************/
+os_mutex_type* os_create_mutex_static( os_mutex_type *storage ) {
+	storage->owner = NO_TID;
+	storage->nextHeld = 0;
+	list_init( &storage->waiting_tasks );
+	return storage;
+}
+
+
+/* Returns the largest number of mutexes ever taken from the pool */
+uint8_t os_mutex_pool_high_water( void ) {
+	return nPoolMutexes;
+}
+
+
+os_tid_t os_mutex_owner_get( os_mutex_type *mutex ) {
+	return mutex->owner;
+}
+
+
+/* Highest priority, i.e. lowest value, of the tasks waiting for the mutex */
+static uint8_t waiters_highest_prio( os_mutex_type *mutex, uint8_t prio ) {
+	os_tid_t tid = list_head( &mutex->waiting_tasks );
+
+	if ( ( tid != NO_TID ) && ( os_task_prio_get( tid ) < prio ) ) {
+		prio = os_task_prio_get( tid );
+	}
+	return prio;
+}
+
+
+static void held_add( os_tid_t tid, os_mutex_type *mutex ) {
+	mutex->owner = tid;
+	mutex->nextHeld = heldMutexes[ tid ];
+	heldMutexes[ tid ] = mutex;
+}
+
+
+static void held_remove( os_tid_t tid, os_mutex_type *mutex ) {
+	os_mutex_type **link = &heldMutexes[ tid ];
+
+	while ( *link != mutex ) {
+		link = &(*link)->nextHeld;
+	}
+	*link = mutex->nextHeld;
+	mutex->nextHeld = 0;
+}
+
+
+/* Sets the priority of a holder to its own priority raised to the highest
+priority waiting for any of the mutexes it still holds */
+static void holder_prio_update( os_tid_t tid ) {
+	uint8_t prio = os_task_base_prio_get( tid );
+	os_mutex_type *mutex;
+
+	for ( mutex = heldMutexes[ tid ]; mutex != 0; mutex = mutex->nextHeld ) {
+		prio = waiters_highest_prio( mutex, prio );
+	}
+	os_task_prio_set( tid, prio );
+}
+
+
+/* Takes the mutex if it is free and returns 1. Otherwise the task is put in
+the wait list, the holder and the chain of tasks it waits for inherit the
+priority of the task when higher, and 0 is returned. */
+uint8_t os_mutex_lock( os_mutex_type *mutex, os_tid_t tid ) {
+	uint8_t taken = 1;
+	uint8_t prio;
+	os_tid_t holder;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	if ( mutex->owner == NO_TID ) {
+		held_add( tid, mutex );
+	}
+	else {
+		os_task_pending_set( tid );
+		list_add( tid, &mutex->waiting_tasks );
+		blockedOn[ tid ] = mutex;
+		taken = 0;
+
+		prio = os_task_prio_get( tid );
+		holder = mutex->owner;
+		while ( prio < os_task_prio_get( holder ) ) {
+			os_task_prio_set( holder, prio );
+			if ( blockedOn[ holder ] == 0 ) {
+				break;
+			}
+			holder = blockedOn[ holder ]->owner;
+		}
+	}
+
+	os_exit_critical( sr );
+	return taken;
+}
+
+
+/* Called when a task is deleted or restarted. A mutex the task waits for no
+longer passes its priority to the holder or the chain of tasks it waits for,
+and the mutexes the task holds are released and handed over to their waiters. */
+void os_mutex_task_cleanup( os_tid_t tid ) {
+	os_mutex_type *mutex;
+	os_tid_t holder;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	mutex = blockedOn[ tid ];
+	if ( mutex != 0 ) {
+		blockedOn[ tid ] = 0;
+		list_remove( tid, &mutex->waiting_tasks );
+		while ( mutex != 0 ) {
+			holder = mutex->owner;
+			holder_prio_update( holder );
+			mutex = blockedOn[ holder ];
+		}
+	}
+
+	while ( heldMutexes[ tid ] != 0 ) {
+		os_mutex_unlock( heldMutexes[ tid ] );
+	}
+
+	os_exit_critical( sr );
+}
+
+
+/* Releases the mutex held by the calling task and drops any priority it
+inherited through it. The mutex is handed over to the highest priority waiting
+task and 1 is returned, or 0 if no task is waiting. */
+uint8_t os_mutex_unlock( os_mutex_type *mutex ) {
+	uint8_t handedOver = 0;
+	os_tid_t owner;
+	os_tid_t tid;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	owner = mutex->owner;
+	if ( owner == NO_TID ) {
+		os_exit_critical( sr );
+		return 0;
+	}
+
+	held_remove( owner, mutex );
+	mutex->owner = NO_TID;
+	holder_prio_update( owner );
+
+	tid = list_move_highest_prio_to_ready( &mutex->waiting_tasks );
+	if ( tid != NO_TID ) {
+		blockedOn[ tid ] = 0;
+		held_add( tid, mutex );
+		holder_prio_update( tid );
+		handedOver = 1;
+	}
+
+	os_exit_critical( sr );
+	return handedOver;
+}
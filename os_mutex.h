@@ -0,0 +1,87 @@
+#ifndef OS_MUTEX_H
+#define OS_MUTEX_H
+
+/** @file os_mutex.h Mutex header file*/
+
+#include "cocoos.h"
+
+/*********************************************************************************/
+/*  OS_LOCK_MUTEX(mutex)                                                 *//**
+*   
+*   Macro for locking a mutex. If the mutex is held by another task, the
+*   calling task waits and the holder inherits its priority when higher, so a
+*   medium priority task can not keep the holder from releasing the mutex.
+*
+*		@param mutex Pointer to a mutex.
+*
+*		@remarks \b Usage: @n A mutex must be unlocked by the task that locked
+*       it, and can not be locked again by its holder.
+* @code 
+os_mutex_type* myMutex;
+main() {
+ ...
+ myMutex = os_create_mutex();
+ ...
+}
+
+static int myTask(void) {
+ OS_BEGIN;	
+  ...
+  OS_LOCK_MUTEX( myMutex );
+  ...
+  OS_UNLOCK_MUTEX( myMutex );
+  ...
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_LOCK_MUTEX(mutex)    OS_LOCK_MUTEX_(mutex)
+#define OS_LOCK_MUTEX_(mutex)	do {\
+								if ( !os_mutex_lock( mutex, running_tid ) )\
+							 	{\
+									OS_SCHEDULE;\
+							  	}\
+						       } while (0)
+
+
+/*********************************************************************************/
+/*  OS_UNLOCK_MUTEX(mutex)                                                 *//**
+*   
+*   Macro for unlocking a mutex. The mutex is handed over to the highest
+*   priority waiting task, and the caller drops back to the priority it had
+*   before inheriting any.
+*
+*		@param mutex Pointer to a mutex held by the calling task.
+*
+*		@remarks \b Usage: @n See OS_LOCK_MUTEX()
+*
+ *******************************************************************************/
+#define OS_UNLOCK_MUTEX(mutex)  OS_UNLOCK_MUTEX_(mutex)
+#define OS_UNLOCK_MUTEX_(mutex)	do {\
+								if ( os_mutex_unlock( mutex ) )\
+								 {\
+									OS_SCHEDULE;\
+								 }\
+							   } while (0)
+
+/* Mutex type. The layout is only public so that mutexes can be allocated
+statically for os_create_mutex_static(). */
+typedef struct mutex {
+		os_tid_t owner;
+		os_wait_list waiting_tasks;
+		struct mutex *nextHeld;
+		} os_mutex_type;
+
+
+
+os_mutex_type* os_create_mutex( void );
+os_mutex_type* os_create_mutex_static( os_mutex_type *storage );
+uint8_t os_mutex_pool_high_water( void );
+uint8_t os_mutex_lock( os_mutex_type *mutex, os_tid_t tid );
+uint8_t os_mutex_unlock( os_mutex_type *mutex );
+os_tid_t os_mutex_owner_get( os_mutex_type *mutex );
+void os_mutex_task_cleanup( os_tid_t tid );
+
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef OS_PORT_H
+#define OS_PORT_H
+
+/** @file os_port.h Port selection header file*/
+
+/* The kernel only touches the hardware through the port: the critical
+section macros below, a free running timestamp used by the trace, and the
+clock driver calling os_tick(). Each port header
+provides
+
+    enable_interrupts(), disable_interrupts()
+    os_cpu_sr, OS_PORT_ENTER_CRITICAL(sr), OS_PORT_EXIT_CRITICAL(sr)
+    OS_THREAD_LOCAL
+    os_port_word, an unsigned type the cpu loads and stores in one access
+    os_port_init()
+    os_port_timestamp(), os_port_timestamp_hz()
+
+The AVR port is used when compiling with avr-gcc, the Linux port when
+building natively on a Linux host. */
+
+#if defined( __AVR__ )
+#define OS_PORT_AVR
+#include "os_port_avr.h"
+#elif defined( __linux__ )
+#define OS_PORT_LINUX
+#include "os_port_linux.h"
+#else
+#error "No cocoOS port for this target"
+#endif
+
+/* The kernel enters critical sections through these. With OS_IRQ_STATS
+defined the outermost critical sections are timed, and os_irq_off_max()
+returns the longest one. */
+#if defined( OS_IRQ_STATS )
+void os_irq_off_begin( void );
+void os_irq_off_end( void );
+#define os_enter_critical(sr)	do { OS_PORT_ENTER_CRITICAL( sr ); os_irq_off_begin(); } while (0)
+#define os_exit_critical(sr)	do { os_irq_off_end(); OS_PORT_EXIT_CRITICAL( sr ); } while (0)
+#else
+#define os_enter_critical(sr)	OS_PORT_ENTER_CRITICAL( sr )
+#define os_exit_critical(sr)	OS_PORT_EXIT_CRITICAL( sr )
+#endif
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef OS_PORT_AVR_H
+#define OS_PORT_AVR_H
+
+/** @file os_port_avr.h AVR port header file*/
+
+#include <inttypes.h>
+#include <io.h>
+#include <interrupt.h>
+
+#if defined( OS_SMP )
+#error "OS_SMP is only supported by the Linux port"
+#endif
+
+#define enable_interrupts()		sei()
+#define disable_interrupts()	cli()
+
+/* Critical sections that can be nested and entered from an ISR. The
+interrupt flag is saved in sr and restored on exit. */
+typedef uint8_t os_cpu_sr;
+#define OS_PORT_ENTER_CRITICAL(sr)	do { (sr) = SREG; cli(); } while (0)
+#define OS_PORT_EXIT_CRITICAL(sr)	do { SREG = (sr); } while (0)
+
+#define OS_THREAD_LOCAL
+
+typedef uint8_t os_port_word;
+
+#define os_port_init()
+
+/* Timestamps count timer 0 pulses, provided by the clock driver */
+uint32_t os_port_timestamp( void );
+uint32_t os_port_timestamp_hz( void );
+
+#endif
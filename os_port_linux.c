@@ -0,0 +1,79 @@
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_port_linux.c
+***
+***     Project: cocoOS
+***
+***************************************************************************************
+***************************************************************************************
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <signal.h>
+#include <time.h>
+#include "cocoos.h"
+
+#if defined( OS_PORT_LINUX )
+
+
+/* The signals treated as interrupts */
+static sigset_t irqSignals;
+
+
+/* Called from os_init(), before any critical section is entered */
+void os_port_init( void ) {
+	sigemptyset( &irqSignals );
+	sigaddset( &irqSignals, OS_PORT_TICK_SIGNAL );
+	sigaddset( &irqSignals, SIGUSR1 );
+	sigaddset( &irqSignals, SIGUSR2 );
+	sigaddset( &irqSignals, SIGIO );
+}
+
+
+/* Returns the signals treated as interrupts */
+const sigset_t* os_port_irq_signals( void ) {
+	return &irqSignals;
+}
+
+
+/* Timestamps are the monotonic clock in ns, truncated to 32 bits */
+uint32_t os_port_timestamp( void ) {
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (uint32_t)( (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec );
+}
+
+
+uint32_t os_port_timestamp_hz( void ) {
+	return 1000000000u;
+}
+
+
+#if !defined( OS_SMP ) && !defined( OS_PORT_NO_IRQ )
+
+void os_port_enable_interrupts( void ) {
+	sigprocmask( SIG_UNBLOCK, &irqSignals, 0 );
+}
+
+
+void os_port_disable_interrupts( void ) {
+	sigprocmask( SIG_BLOCK, &irqSignals, 0 );
+}
+
+
+void os_port_enter_critical( sigset_t *sr ) {
+	sigprocmask( SIG_BLOCK, &irqSignals, sr );
+}
+
+
+void os_port_exit_critical( const sigset_t *sr ) {
+	sigprocmask( SIG_SETMASK, sr, 0 );
+}
+
+#endif
+
+#endif
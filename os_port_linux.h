@@ -0,0 +1,76 @@
+#ifndef OS_PORT_LINUX_H
+#define OS_PORT_LINUX_H
+
+/** @file os_port_linux.h Linux port header file*/
+
+#include <inttypes.h>
+#include <signal.h>
+
+/* Signals playing the role of interrupts. The clock driver delivers the tick
+with OS_PORT_TICK_SIGNAL, the others are free for simulated device ISRs. They
+are all blocked while the kernel is in a critical section. */
+#define OS_PORT_TICK_SIGNAL		SIGALRM
+
+void os_port_init( void );
+const sigset_t* os_port_irq_signals( void );
+uint32_t os_port_timestamp( void );
+uint32_t os_port_timestamp_hz( void );
+
+typedef uint32_t os_port_word;
+
+#if defined( OS_SMP )
+
+/* Multi-core host build: tasks run on several scheduler threads. All kernel
+data is protected by one recursive lock, and running_tid is thread local. */
+#ifndef OS_SMP_MAX_WORKERS
+#define OS_SMP_MAX_WORKERS	8
+#endif
+
+void os_smp_lock( void );
+void os_smp_unlock( void );
+void os_smp_notify( void );
+
+#define enable_interrupts()
+#define disable_interrupts()
+
+typedef uint8_t os_cpu_sr;
+#define OS_PORT_ENTER_CRITICAL(sr)	do { (sr) = 0; os_smp_lock(); } while (0)
+#define OS_PORT_EXIT_CRITICAL(sr)	do { (void)(sr); os_smp_unlock(); } while (0)
+
+#define OS_THREAD_LOCAL			__thread
+
+#elif defined( OS_PORT_NO_IRQ )
+
+/* No signal plays an interrupt: the application calls os_tick() from task
+context, as the benchmarks and simulations do. Critical sections then have
+nothing to block and compile to nothing. */
+#define enable_interrupts()
+#define disable_interrupts()
+
+typedef uint8_t os_cpu_sr;
+#define OS_PORT_ENTER_CRITICAL(sr)	do { (sr) = 0; } while (0)
+#define OS_PORT_EXIT_CRITICAL(sr)	do { (void)(sr); } while (0)
+
+#define OS_THREAD_LOCAL
+
+#else
+
+void os_port_enable_interrupts( void );
+void os_port_disable_interrupts( void );
+void os_port_enter_critical( sigset_t *sr );
+void os_port_exit_critical( const sigset_t *sr );
+
+#define enable_interrupts()		os_port_enable_interrupts()
+#define disable_interrupts()	os_port_disable_interrupts()
+
+/* Critical sections block the interrupt signals. The previous signal mask is
+saved in sr and restored on exit, so they nest and work inside a handler. */
+typedef sigset_t os_cpu_sr;
+#define OS_PORT_ENTER_CRITICAL(sr)	os_port_enter_critical( &(sr) )
+#define OS_PORT_EXIT_CRITICAL(sr)	os_port_exit_critical( &(sr) )
+
+#define OS_THREAD_LOCAL
+
+#endif
+
+#endif
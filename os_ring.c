@@ -0,0 +1,181 @@
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_ring.c
+***
+***     Project: cocoOS
+***
+***************************************************************************************
+***************************************************************************************
+*/
+
+
+#include <inttypes.h>
+#include <string.h>
+#include <assert.h>
+#include "cocoos.h"
+#include "os_ring.h"
+
+
+/*********************************************************************************/
+/*  void os_ring_init()                                              *//**
+*   
+*   Initializes a single producer single consumer ring buffer. One side, e.g. an
+*   ISR, pushes and the other side, e.g. a task, pops. Neither side ever waits for
+*   the other or disables interrupts.
+*
+*		@param ring Pointer to the ring buffer to initialize.
+*
+*		@param buffer Storage for the data.
+*
+*		@param size Size of buffer in bytes, must be a power of two and at most
+*       half the range of os_ring_index.
+*
+*		@return None.
+*	
+*		
+*       @code
+*       static os_ring_type rxRing;
+*       static uint8_t rxData[ 32 ];
+*       os_ring_init( &rxRing, rxData, sizeof( rxData ) );
+*		@endcode
+*       
+*		 */
+/*********************************************************************************/
+void os_ring_init( os_ring_type *ring, void *buffer, os_ring_index size ) {
+	ring->buffer = (uint8_t*)buffer;
+	ring->mask = size - 1;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->event = 0;
+}
+
+
+/* Sets an event to be signaled each time the ring goes from empty to non-empty */
+void os_ring_set_event( os_ring_type *ring, os_event_type *ev ) {
+	ring->event = ev;
+}
+
+
+/*********************************************************************************/
+/*  os_ring_index os_ring_push()                                              *//**
+*   
+*   Copies up to n bytes into the ring. Only to be called by the producer.
+*
+*		@param ring Pointer to a ring buffer.
+*
+*		@param data Bytes to push.
+*
+*		@param n Number of bytes to push.
+*
+*		@return Number of bytes pushed, less than n if the ring got full.
+*       
+*		 */
+/*********************************************************************************/
+os_ring_index os_ring_push( os_ring_type *ring, const void *data, os_ring_index n ) {
+	os_ring_index head = ring->head;
+	os_ring_index tail = os_ring_load_acquire( ring->tail );
+	os_ring_index space = ( ring->mask + 1 ) - (os_ring_index)( head - tail );
+	os_ring_index offset = head & ring->mask;
+	os_ring_index first;
+
+	if ( n > space ) {
+		n = space;
+	}
+	if ( n == 0 ) {
+		return 0;
+	}
+
+	/* Copy in at most two pieces, up to the end of the buffer and from its start */
+	first = ( ring->mask + 1 ) - offset;
+	if ( first > n ) {
+		first = n;
+	}
+	memcpy( ring->buffer + offset, data, first );
+	memcpy( ring->buffer, (const uint8_t*)data + first, n - first );
+
+	os_ring_store_release( ring->head, (os_ring_index)( head + n ) );
+
+	/* The tail is read again after the new head is published. The consumer
+	may have drained the ring since the first read and be about to wait, then
+	it saw the old head and must be woken. */
+	os_ring_fence();
+	tail = os_ring_load_acquire( ring->tail );
+	if ( ( tail == head ) && ( ring->event != 0 ) ) {
+		os_int_signal_event( ring->event );
+	}
+	return n;
+}
+
+
+/*********************************************************************************/
+/*  os_ring_index os_ring_pop()                                              *//**
+*   
+*   Copies up to n bytes out of the ring. Only to be called by the consumer.
+*
+*		@param ring Pointer to a ring buffer.
+*
+*		@param data Destination for the bytes.
+*
+*		@param n Maximum number of bytes to pop.
+*
+*		@return Number of bytes popped, 0 if the ring was empty.
+*       
+*		 */
+/*********************************************************************************/
+os_ring_index os_ring_pop( os_ring_type *ring, void *data, os_ring_index n ) {
+	os_ring_index tail = ring->tail;
+	os_ring_index head = os_ring_load_acquire( ring->head );
+	os_ring_index count = head - tail;
+	os_ring_index offset = tail & ring->mask;
+	os_ring_index first;
+
+	if ( n > count ) {
+		n = count;
+	}
+	if ( n == 0 ) {
+		return 0;
+	}
+
+	first = ( ring->mask + 1 ) - offset;
+	if ( first > n ) {
+		first = n;
+	}
+	memcpy( data, ring->buffer + offset, first );
+	memcpy( (uint8_t*)data + first, ring->buffer, n - first );
+
+	os_ring_store_release( ring->tail, (os_ring_index)( tail + n ) );
+	return n;
+}
+
+
+/* Returns the number of bytes in the ring. Exact for the consumer, a lower
+bound on the free space for the producer. */
+os_ring_index os_ring_count( os_ring_type *ring ) {
+	return (os_ring_index)( os_ring_load_acquire( ring->head ) - os_ring_load_acquire( ring->tail ) );
+}
+
+
+/* Returns 1 if the ring holds data. Otherwise the task is made to wait for the
+ring event in the same critical section, so a push in between is not missed,
+and 0 is returned. A ring without an event is an error, caught by the assert;
+with asserts off the task is left ready and so polls the ring. */
+uint8_t os_ring_wait( os_ring_type *ring, os_tid_t tid ) {
+	uint8_t ready = 1;
+	os_cpu_sr sr;
+
+	assert( ring->event != 0 );
+	os_enter_critical( sr );
+
+	os_ring_fence();
+	if ( os_ring_count( ring ) == 0 ) {
+		if ( ring->event != 0 ) {
+			os_wait_event( tid, ring->event, 1 );
+		}
+		ready = 0;
+	}
+
+	os_exit_critical( sr );
+	return ready;
+}
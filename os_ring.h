@@ -0,0 +1,113 @@
+#ifndef OS_RING_H
+#define OS_RING_H
+
+/** @file os_ring.h Single producer single consumer ring buffer header file*/
+
+#include "cocoos.h"
+
+
+/* Index type of the ring buffer. The indices must be read and written
+atomically by the cpu, so on 8-bit targets keep the default of 8 bits. A ring
+holds at most half the index range, e.g. 128 bytes with 8-bit indices. */
+#ifndef OS_RING_INDEX_BITS
+#define OS_RING_INDEX_BITS	8
+#endif
+
+#if OS_RING_INDEX_BITS == 8
+typedef uint8_t		os_ring_index;
+#elif OS_RING_INDEX_BITS == 16
+typedef uint16_t	os_ring_index;
+#elif OS_RING_INDEX_BITS == 32
+typedef uint32_t	os_ring_index;
+#else
+#error "OS_RING_INDEX_BITS must be 8, 16 or 32"
+#endif
+
+
+/* Each index is written by one side only. The side owning an index publishes
+it with release semantics after touching the data, the other side reads it with
+acquire semantics before touching the data. The full fence orders a side's
+store of its own index before its load of the other index, so the producer and
+a consumer about to wait can not both miss the other's update. */
+#if defined( __GNUC__ )
+#define os_ring_load_acquire( index )			__atomic_load_n( &(index), __ATOMIC_ACQUIRE )
+#define os_ring_store_release( index, value )	__atomic_store_n( &(index), (value), __ATOMIC_RELEASE )
+#define os_ring_fence()							__atomic_thread_fence( __ATOMIC_SEQ_CST )
+#else
+#define os_ring_load_acquire( index )			(index)
+#define os_ring_store_release( index, value )	do { (index) = (value); } while (0)
+#define os_ring_fence()
+#endif
+
+
+/*********************************************************************************/
+/*  OS_RING_WAIT(ring)                                                 *//**
+*   
+*   Macro for waiting until a ring buffer holds data. The ring must have an
+*   event set with os_ring_set_event(). Drain the ring completely before waiting
+*   again, the producer only signals when the ring goes from empty to non-empty.
+*
+*		@param ring Pointer to a ring buffer.
+*
+*		@remarks \b Usage: @n 
+* @code 
+static os_ring_type rxRing;
+static uint8_t rxData[ 32 ];
+main() {
+ ...
+ os_ring_init( &rxRing, rxData, sizeof( rxData ) );
+ os_ring_set_event( &rxRing, os_create_event() );
+ ...
+}
+
+ISR (SIG_UART_RECV)
+{
+	uint8_t c = UDR;
+	os_ring_push( &rxRing, &c, 1 );
+}
+
+static int rxTask(void) {
+ static uint8_t buf[ 8 ];
+ uint8_t n;
+ OS_BEGIN;	
+  for (;;) {
+   OS_RING_WAIT( &rxRing );
+   while ( ( n = os_ring_pop( &rxRing, buf, sizeof( buf ) ) ) != 0 ) {
+    handle( buf, n );
+   }
+  }
+ OS_END;
+ return 0;
+}
+ @endcode 
+ *******************************************************************************/
+#define OS_RING_WAIT(ring)  OS_RING_WAIT_(ring)
+#define OS_RING_WAIT_(ring)		do {\
+								while ( !os_ring_wait( ring, running_tid ) )\
+								{\
+									OS_SCHEDULE;\
+								}\
+							   } while (0)
+
+
+/* Ring buffer type. head is only written by the producer and tail only by the
+consumer, both run freely and are masked when indexing the buffer. */
+typedef struct ring {
+		uint8_t *buffer;
+		os_ring_index mask;
+		os_ring_index head;
+		os_ring_index tail;
+		os_event_type *event;
+		} os_ring_type;
+
+
+
+void os_ring_init( os_ring_type *ring, void *buffer, os_ring_index size );
+void os_ring_set_event( os_ring_type *ring, os_event_type *ev );
+os_ring_index os_ring_push( os_ring_type *ring, const void *data, os_ring_index n );
+os_ring_index os_ring_pop( os_ring_type *ring, void *data, os_ring_index n );
+os_ring_index os_ring_count( os_ring_type *ring );
+uint8_t os_ring_wait( os_ring_type *ring, os_tid_t tid );
+
+
+#endif
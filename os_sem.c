@@ -1,98 +1,180 @@
-/*
-***************************************************************************************
-***************************************************************************************
-***
-***     File: os_sem.c
-***
-***     Project: cocoOS
-***
-***     Author: Peter Eckstrand
-***
-***************************************************************************************
-***************************************************************************************
-
-
-    Version: 1.0.0
-
-    Change log:
-    2009-07-06: 1.0.0 First release
-
-
-***************************************************************************************
-*/
-
-
-#include <inttypes.h>
-#include <stdlib.h>
-#include "cocoos.h"
-#include "os_sem.h"
-
-struct sem {
-		uint8_t value;
-		uint8_t waiting_tasks[ MAX_TASKS ];
-		};
-
-
-							   
-							   
-
-/*********************************************************************************/
-/*  os_sem_type* os_create_sem()                                              *//**
-*   
-*   Creates and initializes a new semaphore.
-*
-*		@param value Initial value of the semaphore value.
-*
-*		@return Returns a pointer to the created semaphore.
-*
-*		@remarks \b Usage: @n A semaphore is created by declaring a variable of type os_sem_type* and then
-*		assigning the os_create_sem(value) return value to that variable.
-*	
-*		
-*       @code
-*       os_sem_type* mySem;
-*       mySem = os_create_sem(0);
-*		@endcode
-*       
-*		 */
-/*********************************************************************************/
-os_sem_type* os_create_sem( uint8_t value ) {
-   uint8_t i;
-   
-   /* Allocate memory */
-   os_sem_type *temp = malloc( sizeof( os_sem_type ) );
-   
-   /* Initialize the value and the waiting list */
-   temp->value = value;
-   i = MAX_TASKS;
-   do {
-   	--i;
-    temp->waiting_tasks[ i ] = NO_TID;
-    
-   } while ( i != 0 );
-   
-   return temp;
-}
-
-
-
-uint8_t os_sem_larger_than_zero( os_sem_type *sem) {
-    return ( sem->value > 0 );
-}
-
-
-void os_sem_decrement( os_sem_type *sem ) {
-    --sem->value;
-}
-
-
-void os_sem_increment( os_sem_type *sem ) {
-    ++sem->value;
-}
-
-
-uint8_t *os_sem_get_wait_list( os_sem_type *sem ) {
-    return sem->waiting_tasks;
-}
-
-
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_sem.c
+***
+***     Project: cocoOS
+***
+***     Author: Peter Eckstrand
+***
+***************************************************************************************
+***************************************************************************************
+
+
+    Version: 1.0.0
+
+    Change log:
+    2009-07-06: 1.0.0 First release
+
+
+***************************************************************************************
+*/
+
+
+#include <inttypes.h>
+#include "cocoos.h"
+#include "os_sem.h"
+
+#if OS_SEM_POOL_SIZE > 0
+static os_sem_type sem_pool[ OS_SEM_POOL_SIZE ];
+#endif
+static uint8_t nPoolSems = 0;
+
+
+							   
+							   
+
+/*********************************************************************************/
+/*  os_sem_type* os_create_sem()                                              *//**
+*   
+*   Creates and initializes a new semaphore, taken from a static pool of
+*   OS_SEM_POOL_SIZE semaphores.
+*
+*		@param value Initial value of the semaphore value.
+*
+*		@return Returns a pointer to the created semaphore, or 0 if the pool is exhausted.
+*
+*		@remarks \b Usage: @n A semaphore is created by declaring a variable of type os_sem_type* and then
+*		assigning the os_create_sem(value) return value to that variable.
+*	
+*		
+*       @code
+*       os_sem_type* mySem;
+*       mySem = os_create_sem(0);
+*		@endcode
+*       
+*		 */
+/*********************************************************************************/
+os_sem_type* os_create_sem( uint8_t value ) {
+#if OS_SEM_POOL_SIZE > 0
+   if ( nPoolSems != OS_SEM_POOL_SIZE ) {
+      return os_create_sem_static( &sem_pool[ nPoolSems++ ], value );
+   }
+#endif
+   return 0;
+}
+
+
+/*********************************************************************************/
+/*  os_sem_type* os_create_sem_static()                                              *//**
+*   
+*   Initializes a semaphore in storage provided by the caller.
+*
+*		@param storage Pointer to the semaphore to initialize.
+*
+*		@param value Initial value of the semaphore value.
+*
+*		@return Returns storage.
+*	
+*		
+*       @code
+*       static os_sem_type mySemStorage;
+*       os_sem_type* mySem;
+*       mySem = os_create_sem_static( &mySemStorage, 0 );
+*		@endcode
+*       
+*		 */
+/*********************************************************************************/
+os_sem_type* os_create_sem_static( os_sem_type *storage, uint8_t value ) {
+   os_sem_type *temp = storage;
+   
+   /* Initialize the value and the waiting list */
+   temp->value = value;
+   list_init( &temp->waiting_tasks );
+   
+   return temp;
+}
+
+
+
+uint8_t os_sem_larger_than_zero( os_sem_type *sem) {
+    return ( sem->value > 0 );
+}
+
+
+void os_sem_decrement( os_sem_type *sem ) {
+    --sem->value;
+}
+
+
+void os_sem_increment( os_sem_type *sem ) {
+    ++sem->value;
+}
+
+
+os_wait_list *os_sem_get_wait_list( os_sem_type *sem ) {
+    return &sem->waiting_tasks;
+}
+
+
+/* Takes the semaphore if its value is larger than zero and returns 1.
+Otherwise the task is put in the wait list and 0 is returned. The test and
+the wait are done in one critical section. */
+uint8_t os_sem_wait( os_sem_type *sem, os_tid_t tid ) {
+    return os_sem_wait_timeout( sem, tid, 0 );
+}
+
+
+/* Like os_sem_wait(), a task put in the wait list gives up waiting after
+ticks ticks, or never if ticks is 0 */
+uint8_t os_sem_wait_timeout( os_sem_type *sem, os_tid_t tid, uint16_t ticks ) {
+    uint8_t taken = 1;
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    if ( os_sem_larger_than_zero( sem ) ) {
+        os_sem_decrement( sem );
+    }
+    else {
+        os_task_pending_set( tid );
+        list_add( tid, &sem->waiting_tasks );
+        taken = 0;
+        OS_TRACE_RECORD( OS_TRACE_SEM_BLOCK, tid, (uintptr_t)sem );
+    }
+    os_task_timeout_set( tid, ticks );
+
+    os_exit_critical( sr );
+    return taken;
+}
+
+
+/* Hands the semaphore over to the highest priority waiting task and returns 1,
+or increments the value and returns 0 if no task is waiting. */
+uint8_t os_sem_signal( os_sem_type *sem ) {
+    uint8_t handedOver = 0;
+    os_tid_t tid;
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    if ( list_is_empty( &sem->waiting_tasks ) ) {
+        os_sem_increment( sem );
+    }
+    else {
+        tid = list_move_highest_prio_to_ready( &sem->waiting_tasks );
+        os_task_sem_handed_set( tid, sem );
+        handedOver = 1;
+        OS_TRACE_RECORD( OS_TRACE_SEM_WAKE, tid, (uintptr_t)sem );
+    }
+
+    os_exit_critical( sr );
+    return handedOver;
+}
+
+
+/* Returns the largest number of semaphores ever taken from the pool */
+uint8_t os_sem_pool_high_water( void ) {
+    return nPoolSems;
+}
+
+
@@ -0,0 +1,131 @@
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_smp.c
+***
+***     Project: cocoOS
+***
+***************************************************************************************
+***************************************************************************************
+*/
+
+#if defined( OS_SMP )
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <inttypes.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "cocoos.h"
+
+
+/* The kernel lock is recursive as kernel functions taking it call each other */
+static pthread_mutex_t kernelLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+/* Signaled each time a task is put in a ready queue */
+static pthread_cond_t workAvailable = PTHREAD_COND_INITIALIZER;
+
+static uint8_t nSmpWorkers = 1;
+
+
+void os_smp_lock( void ) {
+	pthread_mutex_lock( &kernelLock );
+}
+
+
+void os_smp_unlock( void ) {
+	pthread_mutex_unlock( &kernelLock );
+}
+
+
+/* Called with the kernel lock held when a task becomes ready */
+void os_smp_notify( void ) {
+	pthread_cond_signal( &workAvailable );
+}
+
+
+/* Scheduler loop of one worker thread. A claimed task is run without holding
+the kernel lock, so task procedures on different workers run in parallel. */
+static void* os_smp_worker( void *arg ) {
+	uint8_t worker = (uint8_t)(uintptr_t)arg;
+	os_tid_t tid;
+	taskproctype taskproc;
+#if defined( OS_TASK_STATS )
+	uint32_t start;
+#endif
+
+	for (;;) {
+		pthread_mutex_lock( &kernelLock );
+		while ( ( tid = os_task_claim( worker ) ) == NO_TID ) {
+#if defined( OS_TASK_STATS )
+			start = os_port_timestamp();
+			pthread_cond_wait( &workAvailable, &kernelLock );
+			os_cpu_idle_add( os_port_timestamp() - start );
+#else
+			pthread_cond_wait( &workAvailable, &kernelLock );
+#endif
+		}
+		pthread_mutex_unlock( &kernelLock );
+
+		running_tid = tid;
+		taskproc = os_task_taskproc_get( tid );
+		os_task_dispatch( tid );
+		OS_TRACE_RECORD( OS_TRACE_TASK_IN, tid, worker );
+#if defined( OS_TASK_STATS )
+		start = os_task_run_begin( tid );
+		taskproc();
+		os_task_run_end( tid, start );
+#else
+		taskproc();
+#endif
+		OS_TRACE_RECORD( OS_TRACE_TASK_OUT, tid, worker );
+		os_task_release( tid );
+	}
+	return 0;
+}
+
+
+/*********************************************************************************/
+/*  void os_smp_start()                                              *//**
+*   
+*   Starts the task scheduling on several scheduler threads. Each worker runs
+*   the ready tasks of its own queue and steals from the other workers when
+*   its queue is empty. A task only runs on one worker at a time.
+*
+*		@param nWorkers Number of scheduler threads, at most OS_SMP_MAX_WORKERS.
+*       The calling thread becomes worker 0.
+*
+*		@return None.
+*
+*		@remarks \b Usage: @n Replaces os_start() when the number of threads is
+*       chosen at run time.
+*
+*		 */
+/*********************************************************************************/
+void os_smp_start( uint8_t nWorkers ) {
+	pthread_t thread;
+	uint8_t worker;
+
+	if ( nWorkers > OS_SMP_MAX_WORKERS ) {
+		nWorkers = OS_SMP_MAX_WORKERS;
+	}
+	nSmpWorkers = nWorkers ? nWorkers : 1;
+
+	for ( worker = 1; worker < nWorkers; ++worker ) {
+		pthread_create( &thread, 0, os_smp_worker, (void*)(uintptr_t)worker );
+		pthread_detach( thread );
+	}
+
+	os_smp_worker( (void*)0 );
+}
+
+
+/* Number of scheduler threads started by os_smp_start() */
+uint8_t os_smp_workers( void ) {
+	return nSmpWorkers;
+}
+
+
+#endif
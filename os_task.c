@@ -1,187 +1,1476 @@
-/*
-***************************************************************************************
-***************************************************************************************
-***
-***     File: os_task.c
-***
-***     Project: cocoOS
-***
-***     Author: Peter Eckstrand
-***
-***************************************************************************************
-***************************************************************************************
-
-
-    Version: 1.0.0
-
-    Change log:
-    2009-07-06: 1.0.0 First release
-
-
-***************************************************************************************
-*/
-
-
-#include "cocoos.h"
-#include "os_defines.h"
-#include <stdlib.h>
-
-typedef enum {
-    RUNNING,
-    WAITING_TIME,
-    WAITING_EVENT,
-    READY,
-    PENDING
-} TaskState_t;
-
-
-struct tcb {
-    uint8_t tid;
-    uint8_t prio;
-    TaskState_t state;
-    uint8_t eventQueue;
-    uint8_t waitSingleEvent;
-    uint16_t time;
-    taskproctype taskproc;
-};
-
-static tcb* task_list[ MAX_TASKS ];
-static uint8_t nTasks = 0;
-
-
-/*********************************************************************************/
-/*  void os_task_create()                                              *//**
-*   
-*   Creates a task scheduled by the os. The task is put in the ready state.
-*
-*		@param taskproc Pointer to the task procedure.
-*
-*		@param prio Task priority on a scale 0-255 where 0 is the highest priority.
-*
-*		@return None.
-*
-*		@remarks \b Usage: @n Should be called early in system setup, before starting the task 
-*       execution
-*	
-*		
-*       @code
-int main(void) {
-	system_init();
-	os_init();
-	os_create_task( myTaskProc, 1 );
-	...
-}
-*		@endcode
-*       
-*/
-/*********************************************************************************/
-void os_task_create( taskproctype taskproc, uint8_t prio ) {
-    tcb *task = (tcb*)malloc( sizeof(tcb) );
-    task->tid = nTasks;
-    task->prio = prio;
-    task->state = READY;
-    task->eventQueue = 0;
-    task->waitSingleEvent = 0;
-    task->time = 0;
-    task->taskproc = taskproc;
-    task_list[ nTasks ] = task;
-    nTasks++;
-}
-
-
-uint8_t os_task_highest_prio_ready_task( void ) {
-    uint8_t index;
-    uint8_t highest_prio_task = NO_TID;
-    uint8_t highest_prio = 255;
-    disable_interrupts();
-    
-    for ( index = 0; index != nTasks; ++index ) {
-	    if ( task_list[ index ]->state == READY ) {
-            if ( task_list[ index ]->prio < highest_prio ) {
-                highest_prio = task_list[ index ]->prio;
-                highest_prio_task = index;
-            }
-        }
-    }
-	
-	enable_interrupts();
-    return highest_prio_task;
-}
-
-void os_task_ready_set( uint8_t tid ) {
-    task_list[ tid ]->state = READY;
-}
-
-void os_task_pending_set( uint8_t tid ) {
-    task_list[ tid ]->state = PENDING;
-}
-
-
-uint8_t os_task_prio_get( uint8_t tid ) {
-    return task_list[ tid ]->prio;
-}
-
-
-taskproctype os_task_taskproc_get( uint8_t tid ) {
-    return task_list[ tid ]->taskproc;
-}
-
-
-
-
-void os_task_clear_wait_queue( uint8_t tid ) {
-    task_list[ tid ]->waitSingleEvent = 0;
-    task_list[ tid ]->eventQueue = 0;
-    if ( task_list[ tid ]->state == WAITING_EVENT ) {
-        task_list[ tid ]->state = READY;
-    }
-}
-
-
-void os_task_wait_time_set( uint8_t tid, uint16_t time ) {
-    task_list[ tid ]->time = time;
-    task_list[ tid ]->state = WAITING_TIME;
-}
-
-void os_task_wait_event( uint8_t tid, uint8_t eventId, uint8_t waitSingleEvent ) {
-    task_list[ tid ]->eventQueue |= eventId;
-    task_list[ tid ]->waitSingleEvent = waitSingleEvent;
-    task_list[ tid ]->state = WAITING_EVENT;
-}
-
-
-
-
-void os_task_tick( void ) {
-    uint8_t index;
-
-    /* Search all tasks and decrement time for waiting tasks */
-    for ( index = 0; index != nTasks; ++index ) {
-		if ( task_list[ index ]->state == WAITING_TIME ) {
-
-            /* Found a waiting task, is it ready? */
-            if ( --task_list[ index ]->time == 0) {
-			    task_list[ index ]->state = READY;	
-			}
-		}
-	}
-}
-
-void os_task_signal_event( uint8_t evId ) {
-    uint8_t index;
-    uint8_t taskWaitingForEvent;
-
-    for ( index = 0; index != nTasks; index++ ) {
-
-        taskWaitingForEvent = task_list[ index ]->eventQueue & evId;
-        
-        if ( taskWaitingForEvent ) {
-            
-            task_list[ index ]->eventQueue &= ~evId;
-            
-            if ( task_list[ index ]->waitSingleEvent || ( task_list[ index ]->eventQueue == 0 ) ) {
-                os_task_clear_wait_queue( index );
-            }
-        }
-    }
-}
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_task.c
+***
+***     Project: cocoOS
+***
+***     Author: Peter Eckstrand
+***
+***************************************************************************************
+***************************************************************************************
+
+
+    Version: 1.0.0
+
+    Change log:
+    2009-07-06: 1.0.0 First release
+
+
+***************************************************************************************
+*/
+
+
+#include "cocoos.h"
+#include "os_defines.h"
+
+
+static tcb* task_list[ MAX_TASKS ];
+static os_tid_t nTasks = 0;
+
+/* Tids of deleted tasks, reused before a new tid is taken */
+static os_tid_t freeTids[ MAX_TASKS ];
+static os_tid_t nFreeTids = 0;
+
+#if OS_TASK_POOL_SIZE > 0
+static tcb task_pool[ OS_TASK_POOL_SIZE ];
+
+/* Pool task control blocks of deleted tasks */
+static tcb *freePoolTasks[ OS_TASK_POOL_SIZE ];
+static os_tid_t nFreePoolTasks = 0;
+#endif
+static os_tid_t nPoolTasks = 0;
+
+/* Ready tasks are kept in one FIFO queue per priority level. A two level
+bitmap tells which levels are non-empty: bit n in groups is set when any bit in
+levels[ n ] is set, and bit m in levels[ n ] is set when the queue for priority
+16 * n + m holds a task. */
+#define N_READY_LEVELS  ( ( OS_NUM_PRIO + 15 ) / 16 )
+
+typedef struct {
+    uint16_t groups;
+    uint16_t levels[ N_READY_LEVELS ];
+    os_tid_t head[ OS_NUM_PRIO ];
+    os_tid_t tail[ OS_NUM_PRIO ];
+} ReadyQueue_t;
+
+/* With OS_SMP each scheduler thread has its own ready queue, and a task sits
+in the queue of the worker it last ran on. A task claimed by a worker is taken
+out of the queues until the worker releases it. */
+#if defined( OS_SMP )
+static ReadyQueue_t readyQueues[ OS_SMP_MAX_WORKERS ];
+#define TASK_READY_QUEUE( task )    ( &readyQueues[ (task)->worker ] )
+#else
+static ReadyQueue_t readyQueues[ 1 ];
+#define TASK_READY_QUEUE( task )    ( &readyQueues[ 0 ] )
+#endif
+
+#if defined( OS_RR_BUDGET )
+/* Consecutive dispatches a task of each priority level gets before it goes to
+the back of its level, 0 selects the default of OS_RR_BUDGET */
+static uint8_t rrBudget[ OS_NUM_PRIO ];
+#endif
+
+#if defined( OS_EDF )
+/* Ready tasks with a deadline are kept in a binary min-heap ordered on their
+absolute deadline, with the priority breaking ties. A job is released when
+the task becomes ready and completes when it leaves the ready state, its
+deadline is the release tick plus the relative deadline of the task. */
+static os_tid_t edfHeap[ MAX_TASKS ];
+static os_tid_t edfCount = 0;
+#endif
+
+/* Number of ticks since the system started, wraps around */
+static uint32_t tickCount = 0;
+
+/* Tasks in WAITING_TIME are kept in a delta list sorted on wakeup time. The
+time field of each sleeper holds the number of ticks after the previous task
+in the list, so a tick only has to decrement the head. */
+static os_tid_t sleepHead = NO_TID;
+
+/* With OS_TASK_SOA the delta list fields of all tasks are kept in one array
+indexed by tid instead of in the TCBs. Walking the list then reads a few bytes
+per sleeper rather than a cache line of a TCB each, which pays off on a host
+with thousands of tasks. */
+#if defined( OS_TASK_SOA )
+typedef struct {
+    uint16_t time;
+    os_tid_t next;
+    os_tid_t prev;
+} SleepLink_t;
+
+static SleepLink_t sleepLinks[ MAX_TASKS ];
+#define TASK_TIME( tid )        ( sleepLinks[ tid ].time )
+#define TASK_SLEEP_NEXT( tid )  ( sleepLinks[ tid ].next )
+#define TASK_SLEEP_PREV( tid )  ( sleepLinks[ tid ].prev )
+#else
+#define TASK_TIME( tid )        ( task_list[ tid ]->time )
+#define TASK_SLEEP_NEXT( tid )  ( task_list[ tid ]->sleepNext )
+#define TASK_SLEEP_PREV( tid )  ( task_list[ tid ]->sleepPrev )
+#endif
+
+
+static uint8_t lowest_bit( uint16_t bits ) {
+#if defined( __GNUC__ )
+    return (uint8_t)__builtin_ctz( bits );
+#else
+    static const uint8_t nibble[ 16 ] = { 0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0 };
+    uint8_t offset = 0;
+    if ( ( bits & 0x00ff ) == 0 ) {
+        bits >>= 8;
+        offset = 8;
+    }
+    if ( ( bits & 0x000f ) == 0 ) {
+        bits >>= 4;
+        offset += 4;
+    }
+    return offset + nibble[ bits & 0x000f ];
+#endif
+}
+
+
+#if defined( OS_EDF )
+/* Deadlines are compared on their difference so that the tick counter may
+wrap around */
+static Bool edf_before( tcb *a, tcb *b ) {
+    int32_t diff = (int32_t)( a->absDeadline - b->absDeadline );
+    if ( diff != 0 ) {
+        return ( diff < 0 );
+    }
+    return ( a->prio < b->prio );
+}
+
+
+static void edf_place( os_tid_t index, tcb *task ) {
+    edfHeap[ index ] = task->tid;
+    task->heapIndex = index;
+}
+
+
+static void edf_sift_up( os_tid_t index, tcb *task ) {
+    os_tid_t parent;
+    while ( index != 0 ) {
+        parent = ( index - 1 ) / 2;
+        if ( !edf_before( task, task_list[ edfHeap[ parent ] ] ) ) {
+            break;
+        }
+        edf_place( index, task_list[ edfHeap[ parent ] ] );
+        index = parent;
+    }
+    edf_place( index, task );
+}
+
+
+static void edf_sift_down( os_tid_t index, tcb *task ) {
+    os_tid_t child;
+    while ( ( child = 2 * index + 1 ) < edfCount ) {
+        if ( ( child + 1 < edfCount ) && edf_before( task_list[ edfHeap[ child + 1 ] ], task_list[ edfHeap[ child ] ] ) ) {
+            ++child;
+        }
+        if ( !edf_before( task_list[ edfHeap[ child ] ], task ) ) {
+            break;
+        }
+        edf_place( index, task_list[ edfHeap[ child ] ] );
+        index = child;
+    }
+    edf_place( index, task );
+}
+
+
+static void edf_insert( tcb *task ) {
+    task->readyNext = NO_TID;
+    edf_sift_up( edfCount++, task );
+}
+
+
+static void edf_remove( tcb *task ) {
+    os_tid_t index = task->heapIndex;
+    tcb *last = task_list[ edfHeap[ --edfCount ] ];
+
+    if ( last != task ) {
+        if ( ( index != 0 ) && edf_before( last, task_list[ edfHeap[ ( index - 1 ) / 2 ] ] ) ) {
+            edf_sift_up( index, last );
+        }
+        else {
+            edf_sift_down( index, last );
+        }
+    }
+}
+#endif
+
+
+/* Appends the task to the tail of the ready queue of its priority level. The
+head and tail of a level are only valid while its bit in levels is set. */
+static void ready_insert( tcb *task ) {
+    ReadyQueue_t *queue = TASK_READY_QUEUE( task );
+    uint8_t prio = task->prio;
+
+#if defined( OS_SMP )
+    if ( task->claimed ) {
+        return;
+    }
+    os_smp_notify();
+#endif
+
+#if defined( OS_EDF )
+    if ( task->deadline != 0 ) {
+        edf_insert( task );
+        return;
+    }
+#endif
+
+    task->readyNext = NO_TID;
+
+    if ( queue->levels[ prio >> 4 ] & ( 1u << ( prio & 0x0f ) ) ) {
+        task->readyPrev = queue->tail[ prio ];
+        task_list[ queue->tail[ prio ] ]->readyNext = task->tid;
+    }
+    else {
+        task->readyPrev = NO_TID;
+        queue->head[ prio ] = task->tid;
+        queue->levels[ prio >> 4 ] |= ( 1u << ( prio & 0x0f ) );
+        queue->groups |= ( 1u << ( prio >> 4 ) );
+    }
+    queue->tail[ prio ] = task->tid;
+}
+
+
+static void ready_remove( tcb *task ) {
+    ReadyQueue_t *queue = TASK_READY_QUEUE( task );
+    uint8_t prio = task->prio;
+
+#if defined( OS_SMP )
+    if ( task->claimed ) {
+        return;
+    }
+#endif
+
+#if defined( OS_EDF )
+    if ( task->deadline != 0 ) {
+        edf_remove( task );
+        return;
+    }
+#endif
+
+    if ( task->readyPrev == NO_TID ) {
+        queue->head[ prio ] = task->readyNext;
+    }
+    else {
+        task_list[ task->readyPrev ]->readyNext = task->readyNext;
+    }
+
+    if ( task->readyNext == NO_TID ) {
+        queue->tail[ prio ] = task->readyPrev;
+    }
+    else {
+        task_list[ task->readyNext ]->readyPrev = task->readyPrev;
+    }
+
+    if ( ( task->readyPrev == NO_TID ) && ( task->readyNext == NO_TID ) ) {
+        queue->levels[ prio >> 4 ] &= ~( 1u << ( prio & 0x0f ) );
+        if ( queue->levels[ prio >> 4 ] == 0 ) {
+            queue->groups &= ~( 1u << ( prio >> 4 ) );
+        }
+    }
+}
+
+
+/* Returns the task at the head of the highest non-empty level of the queue,
+or with OS_EDF the ready task with the earliest deadline if there is one */
+static os_tid_t ready_highest( ReadyQueue_t *queue ) {
+    uint8_t group;
+#if defined( OS_EDF )
+    if ( edfCount != 0 ) {
+        return edfHeap[ 0 ];
+    }
+#endif
+    if ( queue->groups == 0 ) {
+        return NO_TID;
+    }
+    group = lowest_bit( queue->groups );
+    return queue->head[ ( group << 4 ) + lowest_bit( queue->levels[ group ] ) ];
+}
+
+
+/* Inserts the task in the delta list. Its time field holds the number of
+ticks to sleep on entry and the delta to its predecessor on return. Besides
+the tasks in WAITING_TIME, the list holds the timeouts of tasks waiting for an
+event or a semaphore. */
+static void sleep_insert( tcb *task ) {
+    os_tid_t tid = task->tid;
+    os_tid_t prev = NO_TID;
+    os_tid_t next = sleepHead;
+    uint16_t time = TASK_TIME( tid );
+
+    task->sleeping = 1;
+
+    while ( ( next != NO_TID ) && ( TASK_TIME( next ) <= time ) ) {
+        time -= TASK_TIME( next );
+        prev = next;
+        next = TASK_SLEEP_NEXT( next );
+    }
+
+    TASK_TIME( tid ) = time;
+    TASK_SLEEP_PREV( tid ) = prev;
+    TASK_SLEEP_NEXT( tid ) = next;
+
+    if ( next != NO_TID ) {
+        TASK_TIME( next ) -= time;
+        TASK_SLEEP_PREV( next ) = tid;
+    }
+
+    if ( prev == NO_TID ) {
+        sleepHead = tid;
+    }
+    else {
+        TASK_SLEEP_NEXT( prev ) = tid;
+    }
+}
+
+
+static void sleep_remove( tcb *task ) {
+    os_tid_t tid = task->tid;
+    os_tid_t prev = TASK_SLEEP_PREV( tid );
+    os_tid_t next = TASK_SLEEP_NEXT( tid );
+
+    if ( next != NO_TID ) {
+        TASK_TIME( next ) += TASK_TIME( tid );
+        TASK_SLEEP_PREV( next ) = prev;
+    }
+
+    if ( prev == NO_TID ) {
+        sleepHead = next;
+    }
+    else {
+        TASK_SLEEP_NEXT( prev ) = next;
+    }
+    TASK_TIME( tid ) = 0;
+    task->sleeping = 0;
+}
+
+
+static void event_set_clear( os_event_set *set ) {
+    os_event_id word;
+    for ( word = 0; word != OS_EVENT_SET_WORDS; ++word ) {
+        set->word[ word ] = 0;
+    }
+}
+
+
+static Bool event_set_is_empty( const os_event_set *set ) {
+    os_event_id word;
+    os_event_word bits = 0;
+    for ( word = 0; word != OS_EVENT_SET_WORDS; ++word ) {
+        bits |= set->word[ word ];
+    }
+    return ( bits == 0 );
+}
+
+
+/* Removes a waiter node from the waiter list of its event */
+static void waiter_unlink( os_event_waiter *waiter ) {
+    if ( waiter->prev == 0 ) {
+        waiter->event->waiters = waiter->next;
+    }
+    else {
+        waiter->prev->next = waiter->next;
+    }
+
+    if ( waiter->next != 0 ) {
+        waiter->next->prev = waiter->prev;
+    }
+    waiter->event = 0;
+}
+
+
+/* All state changes go through here so that the ready queues and the delta
+list follow the task states. A deleted task keeps its state until its tid is
+reused. Must be called with interrupts disabled. */
+static void task_state_set( tcb *task, TaskState_t state ) {
+    if ( ( task->state == state ) || ( task->state == DELETED ) ) {
+        return;
+    }
+
+    if ( task->state == READY ) {
+        ready_remove( task );
+#if defined( OS_RR_BUDGET )
+        task->dispatches = 0;
+#endif
+#if defined( OS_EDF )
+        if ( ( task->deadline != 0 ) && ( (int32_t)( tickCount - task->absDeadline ) > 0 ) ) {
+            ++task->deadlineMisses;
+        }
+#endif
+    }
+    else if ( task->sleeping ) {
+        sleep_remove( task );
+    }
+
+    if ( state == READY ) {
+#if defined( OS_EDF )
+        task->absDeadline = tickCount + task->deadline;
+#endif
+        ready_insert( task );
+        list_remove( task->tid, list_waiting_in( task->tid ) );
+#if defined( OS_TASK_STATS )
+        task->readySince = os_port_timestamp();
+#endif
+    }
+    else if ( state == WAITING_TIME ) {
+        sleep_insert( task );
+    }
+    task->state = state;
+}
+
+
+/* Wakes the task at the head of the delta list. A task waiting for an event
+or a semaphore with a timeout is taken out of the wait first and flagged as
+timed out. */
+static void sleep_expire( tcb *task ) {
+    uint8_t index;
+
+    if ( task->state == WAITING_EVENT ) {
+        for ( index = 0; index != OS_MAX_WAIT_EVENTS; ++index ) {
+            if ( task->waiters[ index ].event != 0 ) {
+                waiter_unlink( &task->waiters[ index ] );
+            }
+        }
+        event_set_clear( &task->eventQueue );
+        task->timedOut = 1;
+    }
+    else if ( ( task->state == PENDING ) && ( list_waiting_in( task->tid ) != 0 ) ) {
+        list_remove( task->tid, list_waiting_in( task->tid ) );
+        task->timedOut = 1;
+    }
+    task_state_set( task, READY );
+}
+
+
+/* Takes a task that is deleted or restarted out of everything it may be
+waiting in and releases the mutexes it holds. The task is left pending. */
+static void task_detach( tcb *task ) {
+    uint8_t index;
+    os_sem_type *sem;
+
+    task_state_set( task, PENDING );
+    if ( task->sleeping ) {
+        sleep_remove( task );
+    }
+    os_mutex_task_cleanup( task->tid );
+    list_remove( task->tid, list_waiting_in( task->tid ) );
+    for ( index = 0; index != OS_MAX_WAIT_EVENTS; ++index ) {
+        if ( task->waiters[ index ].event != 0 ) {
+            waiter_unlink( &task->waiters[ index ] );
+        }
+    }
+    event_set_clear( &task->eventQueue );
+    task->waitSingleEvent = 0;
+    task->timedOut = 0;
+    os_msgq_task_cleanup( task->tid );
+
+    /* A semaphore handed over to the task before it got to run is passed on,
+    the task never took it */
+    if ( task->handedSem != 0 ) {
+        sem = task->handedSem;
+        task->handedSem = 0;
+        os_sem_signal( sem );
+    }
+}
+
+
+/* Puts the tid and a pool task control block of a deleted task on the free
+lists */
+static void task_free( tcb *task ) {
+    task_list[ task->tid ] = 0;
+    freeTids[ nFreeTids++ ] = task->tid;
+#if OS_TASK_POOL_SIZE > 0
+    if ( task->pooled ) {
+        freePoolTasks[ nFreePoolTasks++ ] = task;
+    }
+#endif
+}
+
+
+/* Sets up a task in the given task control block and makes it ready. The tid
+of a deleted task is reused if there is one. */
+static os_tid_t task_create( tcb *task, taskproctype taskproc, uint8_t prio, void *arg, uint8_t pooled ) {
+    uint8_t index;
+    os_tid_t tid = NO_TID;
+    os_cpu_sr sr;
+
+    os_enter_critical( sr );
+    if ( nFreeTids != 0 ) {
+        tid = freeTids[ --nFreeTids ];
+    }
+    else if ( nTasks != MAX_TASKS ) {
+        tid = nTasks++;
+    }
+    os_exit_critical( sr );
+
+    if ( tid == NO_TID ) {
+        return NO_TID;
+    }
+
+#if OS_NUM_PRIO < 256
+    if ( prio >= OS_NUM_PRIO ) {
+        prio = OS_NUM_PRIO - 1;
+    }
+#endif
+
+    task->tid = tid;
+    task->prio = prio;
+    task->basePrio = prio;
+    task->state = PENDING;
+    event_set_clear( &task->eventQueue );
+    for ( index = 0; index != OS_MAX_WAIT_EVENTS; ++index ) {
+        task->waiters[ index ].event = 0;
+        task->waiters[ index ].tid = tid;
+    }
+    task->waitSingleEvent = 0;
+    task->sleeping = 0;
+    task->timedOut = 0;
+    task->handedSem = 0;
+#if defined( OS_RR_BUDGET )
+    task->dispatches = 0;
+#endif
+#if defined( OS_EDF )
+    task->deadline = 0;
+    task->absDeadline = 0;
+    task->deadlineMisses = 0;
+#endif
+    task->period = 0;
+    task->overruns = 0;
+    task->nextRelease = 0;
+    task->taskproc = taskproc;
+    task->arg = arg;
+    task->resume = 0;
+    task->pooled = pooled;
+#if defined( OS_SMP )
+    task->claimed = 0;
+    task->worker = tid % OS_SMP_MAX_WORKERS;
+#endif
+#if defined( OS_TASK_STATS )
+    task->runTime = 0;
+    task->runCount = 0;
+    task->maxRunTime = 0;
+    task->readyTime = 0;
+#endif
+    task_list[ tid ] = task;
+    TASK_TIME( tid ) = 0;
+
+    os_enter_critical( sr );
+    task_state_set( task, READY );
+    os_exit_critical( sr );
+
+    return tid;
+}
+
+
+/*********************************************************************************/
+/*  os_tid_t os_task_create()                                              *//**
+*   
+*   Creates a task scheduled by the os. The task is put in the ready state.
+*   The task control block is taken from a static pool of OS_TASK_POOL_SIZE
+*   blocks.
+*
+*		@param taskproc Pointer to the task procedure.
+*
+*		@param prio Task priority on a scale 0-255 where 0 is the highest priority.
+*
+*		@return Task id of the created task, NO_TID if the pool is exhausted.
+*
+*		@remarks \b Usage: @n Should be called early in system setup, before starting the task 
+*       execution
+*	
+*		
+*       @code
+int main(void) {
+	system_init();
+	os_init();
+	os_create_task( myTaskProc, 1 );
+	...
+}
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+os_tid_t os_task_create( taskproctype taskproc, uint8_t prio ) {
+    return os_task_create_arg( taskproc, prio, 0 );
+}
+
+
+/*********************************************************************************/
+/*  os_tid_t os_task_create_arg()                                              *//**
+*   
+*   Creates a task like os_task_create(), with an argument the task procedure
+*   gets with OS_GET_ARG(). Several tasks can share one task procedure, each
+*   with its own argument, as the resume point is kept per task.
+*
+*		@param taskproc Pointer to the task procedure.
+*
+*		@param prio Task priority on a scale 0-255 where 0 is the highest priority.
+*
+*		@param arg Argument of the task, typically a pointer to its context.
+*
+*		@return Task id of the created task, NO_TID if the pool is exhausted.
+*
+*       @code
+static ChannelCtx channels[ 16 ];
+
+int main(void) {
+	uint8_t i;
+	system_init();
+	os_init();
+	for ( i = 0; i != 16; ++i ) {
+		channels[ i ].channel = i;
+		os_task_create_arg( channelTask, 1, &channels[ i ] );
+	}
+	...
+}
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+os_tid_t os_task_create_arg( taskproctype taskproc, uint8_t prio, void *arg ) {
+#if OS_TASK_POOL_SIZE > 0
+    os_tid_t tid = NO_TID;
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    /* Task control blocks of deleted tasks are reused first */
+    if ( nFreePoolTasks != 0 ) {
+        tid = task_create( freePoolTasks[ nFreePoolTasks - 1 ], taskproc, prio, arg, 1 );
+        if ( tid != NO_TID ) {
+            --nFreePoolTasks;
+        }
+    }
+    else if ( nPoolTasks != OS_TASK_POOL_SIZE ) {
+        tid = task_create( &task_pool[ nPoolTasks ], taskproc, prio, arg, 1 );
+        if ( tid != NO_TID ) {
+            ++nPoolTasks;
+        }
+    }
+
+    os_exit_critical( sr );
+    return tid;
+#else
+    return NO_TID;
+#endif
+}
+
+
+/*********************************************************************************/
+/*  os_tid_t os_task_create_static()                                              *//**
+*   
+*   Creates a task using a task control block provided by the caller instead
+*   of one from the pool.
+*
+*		@param storage Pointer to the task control block to use. It must stay
+*       valid as long as the task exists.
+*
+*		@param taskproc Pointer to the task procedure.
+*
+*		@param prio Task priority on a scale 0-255 where 0 is the highest priority.
+*
+*		@return Task id of the created task, NO_TID if MAX_TASKS tasks exist.
+*
+*       @code
+static tcb myTaskTcb;
+
+int main(void) {
+	system_init();
+	os_init();
+	os_task_create_static( &myTaskTcb, myTaskProc, 1 );
+	...
+}
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+os_tid_t os_task_create_static( tcb *storage, taskproctype taskproc, uint8_t prio ) {
+    return os_task_create_static_arg( storage, taskproc, prio, 0 );
+}
+
+
+/*********************************************************************************/
+/*  os_tid_t os_task_create_periodic()                                              *//**
+*   
+*   Creates a periodic task like os_task_create(). The task runs right away
+*   and then once every period ticks, counted from its creation, when it
+*   waits with OS_WAIT_NEXT_PERIOD(). Tasks created otherwise are made
+*   periodic with os_task_period_set().
+*
+*		@param taskproc Pointer to the task procedure.
+*
+*		@param prio Task priority on a scale 0-255 where 0 is the highest priority.
+*
+*		@param period Period in ticks.
+*
+*		@return Task id of the created task, NO_TID if the pool is exhausted.
+*
+*       @code
+int main(void) {
+	system_init();
+	os_init();
+	os_task_create_periodic( ledTask, 1, 200 );
+	...
+}
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+os_tid_t os_task_create_periodic( taskproctype taskproc, uint8_t prio, uint16_t period ) {
+    os_tid_t tid = os_task_create_arg( taskproc, prio, 0 );
+    if ( tid != NO_TID ) {
+        os_task_period_set( tid, period );
+    }
+    return tid;
+}
+
+
+/* Creates a task in a caller provided task control block, with an argument */
+os_tid_t os_task_create_static_arg( tcb *storage, taskproctype taskproc, uint8_t prio, void *arg ) {
+    return task_create( storage, taskproc, prio, arg, 0 );
+}
+
+
+/*********************************************************************************/
+/*  void os_task_delete()                                              *//**
+*   
+*   Deletes a task. The task is taken out of the ready queue, the delta list,
+*   the event, semaphore and message queue waits, and the mutexes it holds are
+*   released. Its tid and, if it came from the pool, its task control block
+*   are reused by the next task created. A task deleting itself is freed when
+*   its task procedure returns, see OS_TASK_EXIT().
+*
+*		@param tid Id of the task to delete. It must not be used afterwards.
+*
+*		@return None.
+*
+*		@remarks \b Usage: @n Called from tasks or main, not from interrupts.
+*       A caller provided task control block may be reused once the task
+*       procedure of the deleted task has returned.
+*
+*       @code
+static int dispatcher( void ) {
+	OS_BEGIN;
+	for (;;) {
+		OS_WAIT_SINGLE_EVENT( requestEvent );
+		worker = os_task_create_arg( workerTask, 2, &request );
+		OS_WAIT_SEM_TIMEOUT( done, 100 );
+		if ( OS_TIMED_OUT() ) {
+			os_task_delete( worker );
+		}
+	}
+	OS_END;
+	return 0;
+}
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+void os_task_delete( os_tid_t tid ) {
+    tcb *task = task_list[ tid ];
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    if ( task->state != DELETED ) {
+        task_detach( task );
+        task->state = DELETED;
+        os_timer_task_deleted( tid );
+#if defined( OS_SMP )
+        if ( !task->claimed ) {
+            task_free( task );
+        }
+#else
+        if ( tid != running_tid ) {
+            task_free( task );
+        }
+#endif
+    }
+
+    os_exit_critical( sr );
+}
+
+
+/*********************************************************************************/
+/*  void os_task_restart()                                              *//**
+*   
+*   Restarts a task from the beginning of its task procedure. The task is
+*   taken out of all waits like by os_task_delete(), releases the mutexes it
+*   holds and is made ready. Its priority, period and deadline are kept, a
+*   periodic task starts a new period grid.
+*
+*		@param tid Id of the task to restart.
+*
+*		@return None.
+*
+*		@remarks \b Usage: @n A task restarting itself must return from its
+*       task procedure right after the call.
+*
+*       @code
+if ( linkLost ) {
+	os_task_restart( protocolTid );
+}
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+void os_task_restart( os_tid_t tid ) {
+    tcb *task = task_list[ tid ];
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    if ( task->state != DELETED ) {
+        task_detach( task );
+        task->resume = 0;
+        task->nextRelease = tickCount + task->period;
+        task_state_set( task, READY );
+    }
+
+    os_exit_critical( sr );
+}
+
+
+/* Returns the largest number of task control blocks ever taken from the pool */
+os_tid_t os_task_pool_high_water( void ) {
+    return nPoolTasks;
+}
+
+
+/* Returns the task at the head of the highest non-empty priority level, in
+constant time regardless of the number of tasks. */
+os_tid_t os_task_highest_prio_ready_task( void ) {
+    os_cpu_sr sr;
+    os_tid_t highest_prio_task;
+    os_enter_critical( sr );
+
+#if defined( OS_SMP )
+    {
+        uint8_t worker;
+        os_tid_t tid;
+        highest_prio_task = NO_TID;
+        for ( worker = 0; worker != OS_SMP_MAX_WORKERS; ++worker ) {
+            tid = ready_highest( &readyQueues[ worker ] );
+            if ( ( tid != NO_TID ) && ( ( highest_prio_task == NO_TID ) ||
+                 ( task_list[ tid ]->prio < task_list[ highest_prio_task ]->prio ) ) ) {
+                highest_prio_task = tid;
+            }
+        }
+    }
+#else
+    highest_prio_task = ready_highest( &readyQueues[ 0 ] );
+#endif
+
+    os_exit_critical( sr );
+    return highest_prio_task;
+}
+
+
+#if defined( OS_SMP )
+/* Claims the highest priority ready task for a worker. If the worker's own
+queue is empty the highest priority task of the other workers is stolen and
+moves to this worker. The claimed task is taken out of the queues, so no other
+worker can run it until os_task_release() is called. */
+os_tid_t os_task_claim( uint8_t worker ) {
+    os_tid_t tid;
+    uint8_t victim;
+    os_tid_t candidate;
+    tcb *task;
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    tid = ready_highest( &readyQueues[ worker ] );
+
+    if ( tid == NO_TID ) {
+        for ( victim = 0; victim != OS_SMP_MAX_WORKERS; ++victim ) {
+            candidate = ready_highest( &readyQueues[ victim ] );
+            if ( ( candidate != NO_TID ) && ( ( tid == NO_TID ) ||
+                 ( task_list[ candidate ]->prio < task_list[ tid ]->prio ) ) ) {
+                tid = candidate;
+            }
+        }
+    }
+
+    if ( tid != NO_TID ) {
+        task = task_list[ tid ];
+        ready_remove( task );
+        task->claimed = 1;
+        task->worker = worker;
+    }
+
+    os_exit_critical( sr );
+    return tid;
+}
+
+
+/* Gives a task back after its procedure has returned. If it is still ready it
+is appended to the ready queue of the worker that ran it, if it was deleted
+meanwhile it is freed. */
+void os_task_release( os_tid_t tid ) {
+    tcb *task = task_list[ tid ];
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    task->claimed = 0;
+    if ( task->state == READY ) {
+        ready_insert( task );
+    }
+    else if ( task->state == DELETED ) {
+        task_free( task );
+    }
+
+    os_exit_critical( sr );
+}
+#endif
+
+void os_task_ready_set( os_tid_t tid ) {
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+    task_state_set( task_list[ tid ], READY );
+    os_exit_critical( sr );
+}
+
+void os_task_pending_set( os_tid_t tid ) {
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+    task_state_set( task_list[ tid ], PENDING );
+    os_exit_critical( sr );
+}
+
+
+uint8_t os_task_prio_get( os_tid_t tid ) {
+    return task_list[ tid ]->prio;
+}
+
+
+/* Called by the scheduler when the task procedure has returned. A task that
+is still ready, i.e. it yielded, goes to the back of its priority level so the
+tasks of a level take turns. With OS_RR_BUDGET defined a task keeps its place
+for the budget of its level of consecutive dispatches. A task that deleted
+itself is freed here. With OS_SMP a released task is always appended to its
+level and freed on release, so nothing is done here. */
+void os_task_rotate( os_tid_t tid ) {
+#if !defined( OS_SMP )
+    tcb *task = task_list[ tid ];
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    if ( task->state == DELETED ) {
+        task_free( task );
+    }
+
+    if ( ( task->state == READY ) && ( task->readyNext != NO_TID ) ) {
+#if defined( OS_RR_BUDGET )
+        uint8_t budget = rrBudget[ task->prio ] ? rrBudget[ task->prio ] : OS_RR_BUDGET;
+        if ( ++task->dispatches >= budget ) {
+            task->dispatches = 0;
+            ready_remove( task );
+            ready_insert( task );
+        }
+#else
+        ready_remove( task );
+        ready_insert( task );
+#endif
+    }
+
+    os_exit_critical( sr );
+#else
+    (void)tid;
+#endif
+}
+
+
+#if defined( OS_RR_BUDGET )
+/*********************************************************************************/
+/*  void os_prio_budget_set()                                              *//**
+*   
+*   Sets the number of consecutive dispatches a task of a priority level gets
+*   before the next ready task of the level is run. Only available when the
+*   kernel is built with OS_RR_BUDGET defined, which is the budget of the
+*   levels not set here.
+*
+*		@param prio Priority level.
+*
+*		@param dispatches Number of dispatches, 0 restores the default.
+*
+*		@return None.
+*
+*       @code
+os_prio_budget_set( 5, 4 );
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+void os_prio_budget_set( uint8_t prio, uint8_t dispatches ) {
+#if OS_NUM_PRIO < 256
+    if ( prio >= OS_NUM_PRIO ) {
+        prio = OS_NUM_PRIO - 1;
+    }
+#endif
+    rrBudget[ prio ] = dispatches;
+}
+#endif
+
+
+#if defined( OS_EDF )
+/*********************************************************************************/
+/*  void os_task_deadline_set()                                              *//**
+*   
+*   Gives the task a relative deadline. Each time the task becomes ready its
+*   absolute deadline is set that many ticks ahead, and among the ready tasks
+*   with a deadline the one with the earliest absolute deadline is run. Tasks
+*   with a deadline run before all tasks without one. A task that waits again
+*   after its deadline has passed counts a deadline miss. Only available when
+*   the kernel is built with OS_EDF defined.
+*
+*		@param tid Task id.
+*
+*		@param ticks Relative deadline in ticks, 0 returns the task to priority
+*       scheduling.
+*
+*		@return None.
+*
+*       @code
+os_tid_t tid = os_task_create( controlTask, 1 );
+os_task_deadline_set( tid, 5 );
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+void os_task_deadline_set( os_tid_t tid, uint16_t ticks ) {
+    tcb *task = task_list[ tid ];
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    if ( task->state == READY ) {
+        ready_remove( task );
+        task->deadline = ticks;
+        task->absDeadline = tickCount + ticks;
+        ready_insert( task );
+    }
+    else {
+        task->deadline = ticks;
+    }
+
+    os_exit_critical( sr );
+}
+
+
+/* Returns the number of jobs of the task that completed after their deadline */
+uint16_t os_task_deadline_misses_get( os_tid_t tid ) {
+    return task_list[ tid ]->deadlineMisses;
+}
+#endif
+
+
+/* Returns the priority the task was created with */
+uint8_t os_task_base_prio_get( os_tid_t tid ) {
+    return task_list[ tid ]->basePrio;
+}
+
+
+/* Changes the priority the task is scheduled with, e.g. for priority
+inheritance. A ready task is moved to the tail of its new priority level. */
+void os_task_prio_set( os_tid_t tid, uint8_t prio ) {
+    tcb *task = task_list[ tid ];
+    os_cpu_sr sr;
+
+#if OS_NUM_PRIO < 256
+    if ( prio >= OS_NUM_PRIO ) {
+        prio = OS_NUM_PRIO - 1;
+    }
+#endif
+
+    os_enter_critical( sr );
+    if ( task->prio != prio ) {
+        if ( task->state == READY ) {
+            ready_remove( task );
+            task->prio = prio;
+            ready_insert( task );
+        }
+        else {
+            task->prio = prio;
+            list_prio_changed( tid );
+        }
+    }
+    os_exit_critical( sr );
+}
+
+
+taskproctype os_task_taskproc_get( os_tid_t tid ) {
+    return task_list[ tid ]->taskproc;
+}
+
+
+/* Called by the scheduler right before it runs the task. A semaphore handed
+over to the task while it waited is taken from here on. */
+void os_task_dispatch( os_tid_t tid ) {
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+    task_list[ tid ]->handedSem = 0;
+    os_exit_critical( sr );
+}
+
+
+/* Records the semaphore handed over to a waiting task, so it is passed on if
+the task is deleted or restarted before it runs */
+void os_task_sem_handed_set( os_tid_t tid, os_sem_type *sem ) {
+    task_list[ tid ]->handedSem = sem;
+}
+
+
+void* os_task_arg_get( os_tid_t tid ) {
+    return task_list[ tid ]->arg;
+}
+
+
+/* Resume point of the task procedure, used by OS_BEGIN and OS_SCHEDULE */
+os_resume_type* os_task_resume_get( os_tid_t tid ) {
+    return &task_list[ tid ]->resume;
+}
+
+
+
+
+void os_task_clear_wait_queue( os_tid_t tid ) {
+    uint8_t index;
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+    for ( index = 0; index != OS_MAX_WAIT_EVENTS; ++index ) {
+        if ( task_list[ tid ]->waiters[ index ].event != 0 ) {
+            waiter_unlink( &task_list[ tid ]->waiters[ index ] );
+        }
+    }
+    task_list[ tid ]->waitSingleEvent = 0;
+    event_set_clear( &task_list[ tid ]->eventQueue );
+    if ( task_list[ tid ]->state == WAITING_EVENT ) {
+        task_state_set( task_list[ tid ], READY );
+    }
+    os_exit_critical( sr );
+}
+
+
+/* Puts the task to sleep for time ticks. A time of 0 leaves the task ready,
+so it only yields. */
+void os_task_wait_time_set( os_tid_t tid, uint16_t time ) {
+    os_cpu_sr sr;
+    if ( time == 0 ) {
+        return;
+    }
+    os_enter_critical( sr );
+
+    /* Leave the delta list first in case the task is already sleeping */
+    task_state_set( task_list[ tid ], READY );
+    TASK_TIME( tid ) = time;
+    task_state_set( task_list[ tid ], WAITING_TIME );
+    os_exit_critical( sr );
+}
+
+/* Makes the task periodic. Its releases are on a fixed grid of period ticks
+starting now, which OS_WAIT_NEXT_PERIOD() waits for. A period of 0 makes
+OS_WAIT_NEXT_PERIOD() a plain yield. */
+void os_task_period_set( os_tid_t tid, uint16_t period ) {
+    tcb *task = task_list[ tid ];
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+    task->period = period;
+    task->nextRelease = tickCount + period;
+    os_exit_critical( sr );
+}
+
+
+/* Puts a periodic task to sleep until its next release. The release times
+are absolute, so the time the task ran and waited to run does not add up
+over the periods. A task that asks for a release that has already passed has
+overrun its period: the overrun is counted, releases missed entirely are
+skipped and the task stays ready to run the late one at once. */
+void os_task_wait_next_period( os_tid_t tid ) {
+    tcb *task = task_list[ tid ];
+    uint32_t late;
+    os_cpu_sr sr;
+
+    if ( task->period == 0 ) {
+        return;
+    }
+    os_enter_critical( sr );
+
+    late = tickCount - task->nextRelease;
+    if ( (int32_t)late < 0 ) {
+        TASK_TIME( tid ) = (uint16_t)( task->nextRelease - tickCount );
+        task_state_set( task, WAITING_TIME );
+    }
+    else if ( late != 0 ) {
+        ++task->overruns;
+        task->nextRelease += ( late / task->period ) * task->period;
+    }
+    task->nextRelease += task->period;
+
+    os_exit_critical( sr );
+}
+
+
+/* Returns the number of periods the task overran */
+uint16_t os_task_overruns_get( os_tid_t tid ) {
+    return task_list[ tid ]->overruns;
+}
+
+
+/* Returns the number of ticks since the system started, read atomically */
+uint32_t os_task_tick_count( void ) {
+    uint32_t ticks;
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+    ticks = tickCount;
+    os_exit_critical( sr );
+    return ticks;
+}
+
+
+/* Arms a timeout for a task that was just put in a wait by os_task_wait_event()
+or a semaphore. After ticks ticks the wait is given up and os_task_timed_out()
+returns 1. Also clears the timed out flag, so it is called on every timed
+wait, also when the task did not have to wait. A task already woken again is
+left alone, as is any task when ticks is 0. */
+void os_task_timeout_set( os_tid_t tid, uint16_t ticks ) {
+    tcb *task = task_list[ tid ];
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    task->timedOut = 0;
+    if ( ( ticks != 0 ) && ( ( task->state == WAITING_EVENT ) || ( task->state == PENDING ) ) ) {
+        if ( task->sleeping ) {
+            sleep_remove( task );
+        }
+        TASK_TIME( tid ) = ticks;
+        sleep_insert( task );
+    }
+
+    os_exit_critical( sr );
+}
+
+
+/* Returns 1 if the last timed wait of the task ended with its timeout */
+uint8_t os_task_timed_out( os_tid_t tid ) {
+    return task_list[ tid ]->timedOut;
+}
+
+
+/* Adds the event to the wait queue of the task and links one of the task's
+waiter nodes into the waiter list of the event. A task waits on at most
+OS_MAX_WAIT_EVENTS events at a time. Returns 0, and leaves the task state
+alone, if all its waiter nodes are taken. */
+uint8_t os_task_wait_event( os_tid_t tid, os_event_type *ev, uint8_t waitSingleEvent ) {
+    uint8_t index;
+    uint8_t waiting = 1;
+    os_event_waiter *waiter;
+    tcb *task = task_list[ tid ];
+    os_event_word *word = &task->eventQueue.word[ OS_EVENT_WORD( ev->id ) ];
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    if ( ( *word & OS_EVENT_MASK( ev->id ) ) == 0 ) {
+        waiting = 0;
+        for ( index = 0; index != OS_MAX_WAIT_EVENTS; ++index ) {
+            waiter = &task->waiters[ index ];
+            if ( waiter->event == 0 ) {
+                waiter->event = ev;
+                waiter->prev = 0;
+                waiter->next = ev->waiters;
+                if ( ev->waiters != 0 ) {
+                    ev->waiters->prev = waiter;
+                }
+                ev->waiters = waiter;
+                *word |= OS_EVENT_MASK( ev->id );
+                waiting = 1;
+                break;
+            }
+        }
+    }
+
+    if ( waiting ) {
+        task->waitSingleEvent = waitSingleEvent;
+        task_state_set( task, WAITING_EVENT );
+    }
+    os_exit_critical( sr );
+    return waiting;
+}
+
+
+
+
+void os_task_tick( void ) {
+    os_tid_t tid;
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    ++tickCount;
+
+    /* Only the head of the delta list is decremented. When it reaches zero the
+    head and all following tasks with a zero delta are due. Interrupts are let
+    in between the tasks, so the time they are off does not grow with the
+    number of tasks due. Another tick may come in between, from an ISR or an
+    SMP tick thread, and find due tasks not yet expired at the head. It
+    decrements the first task still waiting instead, so no delta wraps. */
+    if ( sleepHead != NO_TID ) {
+        tid = sleepHead;
+        while ( ( tid != NO_TID ) && ( TASK_TIME( tid ) == 0 ) ) {
+            tid = TASK_SLEEP_NEXT( tid );
+        }
+        if ( tid != NO_TID ) {
+            --TASK_TIME( tid );
+        }
+        while ( ( sleepHead != NO_TID ) && ( TASK_TIME( sleepHead ) == 0 ) ) {
+            sleep_expire( task_list[ sleepHead ] );
+            os_exit_critical( sr );
+            os_enter_critical( sr );
+        }
+    }
+
+    os_exit_critical( sr );
+}
+
+/* Credits a number of elapsed ticks in one batch, e.g. after a tickless idle
+period. Tasks becoming due are made ready just as with os_task_tick(). */
+void os_task_tick_n( uint16_t ticks ) {
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    tickCount += ticks;
+
+    while ( ( ticks != 0 ) && ( sleepHead != NO_TID ) ) {
+        if ( TASK_TIME( sleepHead ) > ticks ) {
+            TASK_TIME( sleepHead ) -= ticks;
+            break;
+        }
+        ticks -= TASK_TIME( sleepHead );
+        TASK_TIME( sleepHead ) = 0;
+        while ( ( sleepHead != NO_TID ) && ( TASK_TIME( sleepHead ) == 0 ) ) {
+            sleep_expire( task_list[ sleepHead ] );
+        }
+    }
+
+    os_exit_critical( sr );
+}
+
+
+/* Returns the number of ticks until the first sleeping task is due, or 0 if
+no task is sleeping. */
+uint16_t os_task_next_wakeup( void ) {
+    os_cpu_sr sr;
+    uint16_t ticks = 0;
+    os_enter_critical( sr );
+    if ( sleepHead != NO_TID ) {
+        ticks = TASK_TIME( sleepHead );
+    }
+    os_exit_critical( sr );
+    return ticks;
+}
+
+/* Signals the event to the tasks in its waiter list. Tasks not waiting for
+the event are never looked at. */
+void os_task_signal_event( os_event_type *ev ) {
+    os_event_waiter *waiter;
+    os_event_waiter *next;
+    tcb *task;
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    for ( waiter = ev->waiters; waiter != 0; waiter = next ) {
+        next = waiter->next;
+        task = task_list[ waiter->tid ];
+
+        waiter_unlink( waiter );
+        task->eventQueue.word[ OS_EVENT_WORD( ev->id ) ] &= ~OS_EVENT_MASK( ev->id );
+
+        if ( task->waitSingleEvent || event_set_is_empty( &task->eventQueue ) ) {
+            os_task_clear_wait_queue( task->tid );
+        }
+    }
+
+    os_exit_critical( sr );
+}
+
+
+#if defined( OS_TASK_STATS )
+/* Called by the scheduler just before the task procedure. Adds the time the
+task was waiting in the ready queue and returns the start time of the run. */
+uint32_t os_task_run_begin( os_tid_t tid ) {
+    tcb *task = task_list[ tid ];
+    uint32_t start = os_port_timestamp();
+    task->readyTime += start - task->readySince;
+    return start;
+}
+
+
+/* Called by the scheduler when the task procedure has returned */
+void os_task_run_end( os_tid_t tid, uint32_t start ) {
+    tcb *task = task_list[ tid ];
+    uint32_t end;
+    uint32_t runTime;
+    os_cpu_sr sr;
+    os_enter_critical( sr );
+
+    end = os_port_timestamp();
+    runTime = end - start;
+    task->runTime += runTime;
+    ++task->runCount;
+    if ( runTime > task->maxRunTime ) {
+        task->maxRunTime = runTime;
+    }
+
+    /* A task that yielded is ready again from now on */
+    if ( task->state == READY ) {
+        task->readySince = end;
+    }
+
+    os_exit_critical( sr );
+}
+
+
+/*********************************************************************************/
+/*  os_tid_t os_task_stats_get()                                              *//**
+*   
+*   Takes a snapshot of the run time statistics of all tasks. Only available
+*   when the kernel is built with OS_TASK_STATS defined.
+*
+*		@param stats Array receiving one entry per existing task, in tid order.
+*
+*		@param maxTasks Number of entries in the stats array.
+*
+*		@return Number of entries written.
+*
+*		@remarks \b Usage: @n Each entry is copied atomically, the entries of
+*       different tasks are taken one after the other.
+*
+*       @code
+os_task_stats stats[ MAX_TASKS ];
+os_tid_t n = os_task_stats_get( stats, MAX_TASKS );
+*		@endcode
+*       
+*/
+/*********************************************************************************/
+os_tid_t os_task_stats_get( os_task_stats *stats, os_tid_t maxTasks ) {
+    os_tid_t tid;
+    os_tid_t n = 0;
+    tcb *task;
+    os_cpu_sr sr;
+
+    for ( tid = 0; ( tid != nTasks ) && ( n != maxTasks ); ++tid ) {
+        os_enter_critical( sr );
+        task = task_list[ tid ];
+        if ( task != 0 ) {
+            stats[ n ].tid = tid;
+            stats[ n ].prio = task->prio;
+            stats[ n ].runTime = task->runTime;
+            stats[ n ].runCount = task->runCount;
+            stats[ n ].maxRunTime = task->maxRunTime;
+            stats[ n ].readyTime = task->readyTime;
+            ++n;
+        }
+        os_exit_critical( sr );
+    }
+    return n;
+}
+#endif
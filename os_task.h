@@ -1,25 +1,139 @@
-#ifndef OS_TASK_H__
-#define OS_TASK_H__
-
-/** @file os_task.h Task header file*/
-
-#include "os_defines.h"
-
-typedef struct tcb tcb;
-
-void os_task_create( taskproctype taskproc, uint8_t prio );
-uint8_t os_task_highest_prio_ready_task( void );
-void os_task_ready_set( uint8_t tid );
-void os_task_pending_set( uint8_t tid );
-uint8_t os_task_prio_get( uint8_t tid );
-taskproctype os_task_taskproc_get( uint8_t tid );
-void os_task_clear_wait_queue( uint8_t tid );
-void os_task_wait_time_set( uint8_t tid, uint16_t time );
-void os_task_wait_event( uint8_t tid, uint8_t eventId, uint8_t waitSingleEvent );
-void os_task_tick( void );
-void os_task_signal_event( uint8_t evId );
-
-
-
-
-#endif
+#ifndef OS_TASK_H__
+#define OS_TASK_H__
+
+/** @file os_task.h Task header file*/
+
+#include "os_defines.h"
+#include "os_event.h"
+
+typedef enum {
+    RUNNING,
+    WAITING_TIME,
+    WAITING_EVENT,
+    READY,
+    PENDING,
+    DELETED
+} TaskState_t;
+
+
+/* Task control block. The layout is only public so that a tcb can be
+allocated statically for os_task_create_static(), the fields are private
+to the kernel. */
+typedef struct tcb {
+    os_tid_t tid;
+    uint8_t prio;
+    uint8_t basePrio;
+    TaskState_t state;
+    os_event_set eventQueue;
+    os_event_waiter waiters[ OS_MAX_WAIT_EVENTS ];
+    uint8_t waitSingleEvent;
+#if !defined( OS_TASK_SOA )
+    uint16_t time;
+#endif
+    taskproctype taskproc;
+    void *arg;
+    os_resume_type resume;
+    uint8_t pooled;
+    os_tid_t readyNext;
+    os_tid_t readyPrev;
+#if defined( OS_RR_BUDGET )
+    uint8_t dispatches;
+#endif
+#if defined( OS_EDF )
+    uint16_t deadline;
+    uint32_t absDeadline;
+    uint16_t deadlineMisses;
+    os_tid_t heapIndex;
+#endif
+    uint16_t period;
+    uint16_t overruns;
+    uint32_t nextRelease;
+#if !defined( OS_TASK_SOA )
+    os_tid_t sleepNext;
+    os_tid_t sleepPrev;
+#endif
+    uint8_t sleeping;
+    uint8_t timedOut;
+    os_sem_type *handedSem;
+#if defined( OS_SMP )
+    uint8_t claimed;
+    uint8_t worker;
+#endif
+#if defined( OS_TASK_STATS )
+    uint32_t runTime;
+    uint32_t runCount;
+    uint32_t maxRunTime;
+    uint32_t readyTime;
+    uint32_t readySince;
+#endif
+} tcb;
+
+
+#if defined( OS_TASK_STATS )
+/* Run time statistics of a task. Times are in port timestamp units, see
+os_port_timestamp_hz(). The sums wrap around, so on a long running system
+use the difference between two snapshots. */
+typedef struct {
+    os_tid_t tid;
+    uint8_t prio;
+    uint32_t runTime;       /* Total time spent in the task procedure */
+    uint32_t runCount;      /* Number of times the task procedure was called */
+    uint32_t maxRunTime;    /* Longest single call of the task procedure */
+    uint32_t readyTime;     /* Total time spent ready before being dispatched */
+} os_task_stats;
+#endif
+
+os_tid_t os_task_create( taskproctype taskproc, uint8_t prio );
+os_tid_t os_task_create_arg( taskproctype taskproc, uint8_t prio, void *arg );
+os_tid_t os_task_create_static( tcb *storage, taskproctype taskproc, uint8_t prio );
+os_tid_t os_task_create_static_arg( tcb *storage, taskproctype taskproc, uint8_t prio, void *arg );
+os_tid_t os_task_create_periodic( taskproctype taskproc, uint8_t prio, uint16_t period );
+void os_task_delete( os_tid_t tid );
+void os_task_restart( os_tid_t tid );
+os_tid_t os_task_pool_high_water( void );
+os_tid_t os_task_highest_prio_ready_task( void );
+void os_task_ready_set( os_tid_t tid );
+void os_task_pending_set( os_tid_t tid );
+uint8_t os_task_prio_get( os_tid_t tid );
+uint8_t os_task_base_prio_get( os_tid_t tid );
+void os_task_prio_set( os_tid_t tid, uint8_t prio );
+void os_task_rotate( os_tid_t tid );
+#if defined( OS_RR_BUDGET )
+void os_prio_budget_set( uint8_t prio, uint8_t dispatches );
+#endif
+#if defined( OS_EDF )
+void os_task_deadline_set( os_tid_t tid, uint16_t ticks );
+uint16_t os_task_deadline_misses_get( os_tid_t tid );
+#endif
+taskproctype os_task_taskproc_get( os_tid_t tid );
+void os_task_dispatch( os_tid_t tid );
+void os_task_sem_handed_set( os_tid_t tid, os_sem_type *sem );
+void* os_task_arg_get( os_tid_t tid );
+os_resume_type* os_task_resume_get( os_tid_t tid );
+void os_task_clear_wait_queue( os_tid_t tid );
+void os_task_wait_time_set( os_tid_t tid, uint16_t time );
+uint8_t os_task_wait_event( os_tid_t tid, os_event_type *ev, uint8_t waitSingleEvent );
+void os_task_period_set( os_tid_t tid, uint16_t period );
+void os_task_wait_next_period( os_tid_t tid );
+uint16_t os_task_overruns_get( os_tid_t tid );
+uint32_t os_task_tick_count( void );
+void os_task_timeout_set( os_tid_t tid, uint16_t ticks );
+uint8_t os_task_timed_out( os_tid_t tid );
+void os_task_tick( void );
+#if defined( OS_SMP )
+os_tid_t os_task_claim( uint8_t worker );
+void os_task_release( os_tid_t tid );
+#endif
+void os_task_tick_n( uint16_t ticks );
+uint16_t os_task_next_wakeup( void );
+void os_task_signal_event( os_event_type *ev );
+#if defined( OS_TASK_STATS )
+uint32_t os_task_run_begin( os_tid_t tid );
+void os_task_run_end( os_tid_t tid, uint32_t start );
+os_tid_t os_task_stats_get( os_task_stats *stats, os_tid_t maxTasks );
+#endif
+
+
+
+
+#endif
@@ -0,0 +1,431 @@
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_timer.c
+***
+***     Project: cocoOS
+***
+***************************************************************************************
+***************************************************************************************
+*/
+
+
+#include <inttypes.h>
+#include "cocoos.h"
+#include "os_timer.h"
+
+#define TIMER_SLOT_MASK		( OS_TIMER_SLOTS - 1 )
+
+#if OS_TIMER_POOL_SIZE > 0
+static os_timer_type timer_pool[ OS_TIMER_POOL_SIZE ];
+#endif
+static uint8_t nPoolTimers = 0;
+
+/* Level n of the wheel holds the timers expiring 2^( n * OS_TIMER_WHEEL_BITS )
+or more ticks ahead, in the slot given by the bits of their expiry time for
+that level. When the index of level 0 wraps, the current slot of level 1 is
+cascaded down into level 0, and so on upwards. */
+static os_timer_type *wheel[ OS_TIMER_LEVELS ][ OS_TIMER_SLOTS ];
+static uint32_t wheelTime = 0;
+static uint16_t nArmed = 0;
+
+/* Expired timers with a callback, waiting for the timer task */
+static os_timer_type *pendingHead = 0;
+static os_timer_type *pendingTail = 0;
+static os_tid_t timerTid = NO_TID;
+
+
+static void timer_link( os_timer_type **list, os_timer_type *timer ) {
+	timer->list = list;
+	timer->prev = 0;
+	timer->next = *list;
+	if ( *list != 0 ) {
+		(*list)->prev = timer;
+	}
+	*list = timer;
+}
+
+
+static void timer_unlink( os_timer_type *timer ) {
+	if ( timer->prev != 0 ) {
+		timer->prev->next = timer->next;
+	}
+	else {
+		*timer->list = timer->next;
+	}
+
+	if ( timer->next != 0 ) {
+		timer->next->prev = timer->prev;
+	}
+	timer->list = 0;
+}
+
+
+/* Puts the timer in the slot of the lowest level whose range covers the
+ticks left until it expires */
+static void wheel_insert( os_timer_type *timer ) {
+	uint32_t delta = timer->expires - wheelTime;
+	uint8_t level = 0;
+
+	while ( ( level != OS_TIMER_LEVELS - 1 ) && ( delta >= ( (uint32_t)1 << ( OS_TIMER_WHEEL_BITS * ( level + 1 ) ) ) ) ) {
+		++level;
+	}
+	timer_link( &wheel[ level ][ ( timer->expires >> ( OS_TIMER_WHEEL_BITS * level ) ) & TIMER_SLOT_MASK ], timer );
+}
+
+
+static void wheel_cascade( os_timer_type **slot ) {
+	os_timer_type *timer = *slot;
+	os_timer_type *next;
+
+	*slot = 0;
+	while ( timer != 0 ) {
+		next = timer->next;
+		wheel_insert( timer );
+		timer = next;
+	}
+}
+
+
+/* Handles a timer taken out of the wheel as it expired. A periodic timer is
+put back one period after its previous expiry, so it does not drift. */
+static void timer_expire( os_timer_type *timer ) {
+	if ( timer->period != 0 ) {
+		timer->expires += timer->period;
+		wheel_insert( timer );
+	}
+	else {
+		--nArmed;
+	}
+
+	if ( timer->event != 0 ) {
+		os_signal_event( timer->event );
+	}
+
+	if ( timer->callback != 0 ) {
+		timer->fired = 1;
+		if ( !timer->queued ) {
+			timer->queued = 1;
+			timer->pendingNext = 0;
+			if ( pendingTail != 0 ) {
+				pendingTail->pendingNext = timer;
+			}
+			else {
+				pendingHead = timer;
+			}
+			pendingTail = timer;
+		}
+		if ( timerTid != NO_TID ) {
+			os_task_ready_set( timerTid );
+		}
+	}
+}
+
+
+/* Takes the next timer whose callback is due off the pending list. A timer
+stopped after it expired stays in the list until here, but is skipped. */
+static uint8_t timer_pending_get( os_timer_callback *callback, void **arg ) {
+	os_timer_type *timer;
+	uint8_t found = 0;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	while ( !found && ( pendingHead != 0 ) ) {
+		timer = pendingHead;
+		pendingHead = timer->pendingNext;
+		if ( pendingHead == 0 ) {
+			pendingTail = 0;
+		}
+		timer->queued = 0;
+
+		if ( timer->fired ) {
+			timer->fired = 0;
+			*callback = timer->callback;
+			*arg = timer->arg;
+			found = 1;
+		}
+	}
+
+	os_exit_critical( sr );
+	return found;
+}
+
+
+/* Runs the callbacks of expired timers. The task is made pending before the
+list is emptied, so a timer expiring meanwhile makes it ready again. */
+static int timer_task( void ) {
+	os_timer_callback callback;
+	void *arg;
+
+	OS_BEGIN;
+	for (;;) {
+		os_task_pending_set( running_tid );
+		while ( timer_pending_get( &callback, &arg ) ) {
+			callback( arg );
+		}
+		OS_SCHEDULE;
+	}
+	OS_END;
+	return 0;
+}
+
+
+/*********************************************************************************/
+/*  os_timer_type* os_create_timer()                                              *//**
+*
+*   Creates a stopped software timer, taken from a static pool of
+*   OS_TIMER_POOL_SIZE timers. When the timer expires its callback is run by
+*   the timer task, see os_timer_task_create(), and its event is signaled.
+*
+*		@param callback Function to run when the timer expires, or 0.
+*
+*		@param arg Argument passed to the callback.
+*
+*		@param ev Event to signal when the timer expires, or 0.
+*
+*		@return Returns a pointer to the created timer, or 0 if the pool is exhausted.
+*
+*
+*       @code
+*       os_timer_type* retransmitTimer;
+*       retransmitTimer = os_create_timer( retransmit, &link, 0 );
+*       os_timer_start( retransmitTimer, 50, 0 );
+*		@endcode
+*
+*		 */
+/*********************************************************************************/
+os_timer_type* os_create_timer( os_timer_callback callback, void *arg, os_event_type *ev ) {
+#if OS_TIMER_POOL_SIZE > 0
+	if ( nPoolTimers != OS_TIMER_POOL_SIZE ) {
+		return os_create_timer_static( &timer_pool[ nPoolTimers++ ], callback, arg, ev );
+	}
+#endif
+	return 0;
+}
+
+
+/*********************************************************************************/
+/*  os_timer_type* os_create_timer_static()                                              *//**
+*
+*   Initializes a stopped software timer in storage provided by the caller.
+*   Large numbers of timers are best kept this way, e.g. one per connection.
+*
+*		@param storage Pointer to the timer to initialize.
+*
+*		@param callback Function to run when the timer expires, or 0.
+*
+*		@param arg Argument passed to the callback.
+*
+*		@param ev Event to signal when the timer expires, or 0.
+*
+*		@return Returns storage.
+*
+*
+*       @code
+*       static os_timer_type timeouts[ 1000 ];
+*       os_create_timer_static( &timeouts[ i ], connectionTimeout, &connections[ i ], 0 );
+*		@endcode
+*
+*		 */
+/*********************************************************************************/
+os_timer_type* os_create_timer_static( os_timer_type *storage, os_timer_callback callback, void *arg, os_event_type *ev ) {
+	storage->next = 0;
+	storage->prev = 0;
+	storage->list = 0;
+	storage->pendingNext = 0;
+	storage->expires = 0;
+	storage->period = 0;
+	storage->callback = callback;
+	storage->arg = arg;
+	storage->event = ev;
+	storage->queued = 0;
+	storage->fired = 0;
+	return storage;
+}
+
+
+/* Returns the number of timers taken from the pool */
+uint8_t os_timer_pool_high_water( void ) {
+	return nPoolTimers;
+}
+
+
+/*********************************************************************************/
+/*  os_tid_t os_timer_task_create()                                              *//**
+*
+*   Creates the task running the callbacks of expired timers. Callbacks run
+*   in task context, so they may signal events and semaphores, but must not
+*   use the OS_ macros that suspend a task. Only needed when timers with a
+*   callback are used.
+*
+*		@param prio Priority of the timer task.
+*
+*		@return Task id of the timer task, NO_TID if it could not be created.
+*
+*
+*       @code
+int main(void) {
+	system_init();
+	os_init();
+	os_timer_task_create( 0 );
+	...
+}
+*		@endcode
+*
+*		 */
+/*********************************************************************************/
+os_tid_t os_timer_task_create( uint8_t prio ) {
+	if ( timerTid == NO_TID ) {
+		timerTid = os_task_create( timer_task, prio );
+	}
+	return timerTid;
+}
+
+
+/* Called when a task is deleted, so the timer task is not woken under a tid
+that is reused by another task */
+void os_timer_task_deleted( os_tid_t tid ) {
+	if ( tid == timerTid ) {
+		timerTid = NO_TID;
+	}
+}
+
+
+/*********************************************************************************/
+/*  void os_timer_start()                                              *//**
+*
+*   Starts the timer, or restarts it if it is already running. A callback
+*   still due from an earlier expiry is dropped.
+*
+*		@param timer Pointer to the timer.
+*
+*		@param delay Number of ticks until the first expiry, at least 1.
+*
+*		@param period Number of ticks between further expiries, 0 for a one
+*       shot timer. Periodic expiries are counted from the previous expiry, so
+*       they do not drift. If the callback of a periodic timer has not run yet
+*       when the timer expires again, it runs once.
+*
+*		@return None.
+*
+*
+*       @code
+*       os_timer_start( blinkTimer, 100, 100 );
+*		@endcode
+*
+*		 */
+/*********************************************************************************/
+void os_timer_start( os_timer_type *timer, uint16_t delay, uint16_t period ) {
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	if ( timer->list != 0 ) {
+		timer_unlink( timer );
+	}
+	else {
+		++nArmed;
+	}
+	timer->fired = 0;
+	timer->period = period;
+	timer->expires = wheelTime + ( delay != 0 ? delay : 1 );
+	wheel_insert( timer );
+
+	os_exit_critical( sr );
+}
+
+
+/* Stops the timer. A callback still due from an earlier expiry is dropped. */
+void os_timer_stop( os_timer_type *timer ) {
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	if ( timer->list != 0 ) {
+		timer_unlink( timer );
+		--nArmed;
+	}
+	timer->fired = 0;
+
+	os_exit_critical( sr );
+}
+
+
+/* Returns 1 if the timer is running */
+uint8_t os_timer_active( os_timer_type *timer ) {
+	return ( timer->list != 0 );
+}
+
+
+/* Advances the wheel by one tick, called by os_tick() */
+void os_timer_tick( void ) {
+	os_timer_type **slot;
+	uint32_t time;
+	uint8_t level;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	++wheelTime;
+	if ( nArmed != 0 ) {
+		time = wheelTime;
+		for ( level = 1; ( level != OS_TIMER_LEVELS ) && ( ( time & TIMER_SLOT_MASK ) == 0 ); ++level ) {
+			time >>= OS_TIMER_WHEEL_BITS;
+			wheel_cascade( &wheel[ level ][ time & TIMER_SLOT_MASK ] );
+		}
+
+		/* Everything left in the current slot of level 0 expires now */
+		slot = &wheel[ 0 ][ wheelTime & TIMER_SLOT_MASK ];
+		while ( *slot != 0 ) {
+			os_timer_type *timer = *slot;
+			timer_unlink( timer );
+			timer_expire( timer );
+		}
+	}
+
+	os_exit_critical( sr );
+}
+
+
+/* Credits a number of elapsed ticks in one batch, e.g. after a tickless idle
+period. With no timer running the wheel only moves its time. */
+void os_timer_tick_n( uint16_t ticks ) {
+	os_cpu_sr sr;
+
+	while ( ticks != 0 ) {
+		os_enter_critical( sr );
+		if ( nArmed == 0 ) {
+			wheelTime += ticks;
+			ticks = 0;
+		}
+		os_exit_critical( sr );
+
+		if ( ticks != 0 ) {
+			os_timer_tick();
+			--ticks;
+		}
+	}
+}
+
+
+/* Returns the number of ticks until the wheel has work to do, at most the
+ticks until the next cascade, or 0 if no timer is running. Used for tickless
+idle. */
+uint16_t os_timer_next_expiry( void ) {
+	uint16_t ticks = 0;
+	uint16_t n;
+	uint32_t time;
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+
+	if ( nArmed != 0 ) {
+		for ( n = 1; n <= OS_TIMER_SLOTS; ++n ) {
+			time = wheelTime + n;
+			if ( ( ( time & TIMER_SLOT_MASK ) == 0 ) || ( wheel[ 0 ][ time & TIMER_SLOT_MASK ] != 0 ) ) {
+				ticks = n;
+				break;
+			}
+		}
+	}
+
+	os_exit_critical( sr );
+	return ticks;
+}
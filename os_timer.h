@@ -0,0 +1,61 @@
+#ifndef OS_TIMER_H
+#define OS_TIMER_H
+
+/** @file os_timer.h Software timer header file*/
+
+#include "cocoos.h"
+
+/* Armed timers are kept in a hierarchical timer wheel of OS_TIMER_LEVELS
+levels of 2^OS_TIMER_WHEEL_BITS slots each, enough levels to cover a 16 bit
+delay. Starting and stopping a timer is O(1), and so is the work per tick,
+amortized over the cascades from the upper levels. Each slot costs a pointer
+of ram, so small targets may lower the number of bits. */
+#ifndef OS_TIMER_WHEEL_BITS
+#define OS_TIMER_WHEEL_BITS	6
+#endif
+
+#if ( OS_TIMER_WHEEL_BITS < 1 ) || ( OS_TIMER_WHEEL_BITS > 8 )
+#error "OS_TIMER_WHEEL_BITS must be between 1 and 8"
+#endif
+
+#define OS_TIMER_SLOTS		( 1u << OS_TIMER_WHEEL_BITS )
+#define OS_TIMER_LEVELS		( ( 16 + OS_TIMER_WHEEL_BITS - 1 ) / OS_TIMER_WHEEL_BITS )
+
+#ifndef OS_TIMER_POOL_SIZE
+#define OS_TIMER_POOL_SIZE	4
+#endif
+
+typedef void (*os_timer_callback) ( void *arg );
+
+/* Timer type. The layout is only public so that timers can be allocated
+statically for os_create_timer_static(), the fields are private to the
+kernel. */
+typedef struct os_timer {
+		struct os_timer *next;
+		struct os_timer *prev;
+		struct os_timer **list;
+		struct os_timer *pendingNext;
+		uint32_t expires;
+		uint16_t period;
+		os_timer_callback callback;
+		void *arg;
+		os_event_type *event;
+		uint8_t queued;
+		uint8_t fired;
+		} os_timer_type;
+
+
+os_timer_type* os_create_timer( os_timer_callback callback, void *arg, os_event_type *ev );
+os_timer_type* os_create_timer_static( os_timer_type *storage, os_timer_callback callback, void *arg, os_event_type *ev );
+uint8_t os_timer_pool_high_water( void );
+os_tid_t os_timer_task_create( uint8_t prio );
+void os_timer_task_deleted( os_tid_t tid );
+void os_timer_start( os_timer_type *timer, uint16_t delay, uint16_t period );
+void os_timer_stop( os_timer_type *timer );
+uint8_t os_timer_active( os_timer_type *timer );
+void os_timer_tick( void );
+void os_timer_tick_n( uint16_t ticks );
+uint16_t os_timer_next_expiry( void );
+
+
+#endif
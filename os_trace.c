@@ -0,0 +1,117 @@
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: os_trace.c
+***
+***     Project: cocoOS
+***
+***************************************************************************************
+***************************************************************************************
+*/
+
+
+#include <inttypes.h>
+#include "cocoos.h"
+
+#ifdef OS_TRACE
+
+
+static os_trace_entry traceBuffer[ OS_TRACE_ENTRIES ];
+
+/* Total number of entries recorded, wraps around. The entry to write next is
+traceHead modulo OS_TRACE_ENTRIES. */
+static uint16_t traceHead;
+
+/* Set once the buffer has been filled, from then on every slot is valid */
+static uint8_t traceFull;
+
+
+/*********************************************************************************/
+/*  void os_trace_record()                                              *//**
+*   
+*   Records a trace entry with the current port timestamp. Called by the kernel
+*   through OS_TRACE_RECORD(), which is empty unless OS_TRACE is defined.
+*
+*		@param type One of the OS_TRACE_ entry types.
+*
+*		@param tid Task the entry is about.
+*
+*		@param arg Type specific argument.
+*
+*		@return None.
+*
+*		@remarks \b Usage: @n Can be called from tasks and ISRs. Only the slot is
+*       claimed atomically, the entry is then written without any lock.
+*
+*		 */
+/*********************************************************************************/
+void os_trace_record( uint8_t type, os_tid_t tid, uint16_t arg ) {
+	os_trace_entry *entry;
+	uint16_t index;
+
+#if defined( OS_PORT_AVR )
+	os_cpu_sr sr;
+	os_enter_critical( sr );
+	index = traceHead++;
+	os_exit_critical( sr );
+#else
+	index = __atomic_fetch_add( &traceHead, 1, __ATOMIC_RELAXED );
+#endif
+
+	if ( index == OS_TRACE_ENTRIES - 1 ) {
+		traceFull = 1;
+	}
+
+	entry = &traceBuffer[ index & ( OS_TRACE_ENTRIES - 1 ) ];
+	entry->time = os_port_timestamp();
+	entry->type = type;
+	entry->tid = tid;
+	entry->arg = arg;
+#if OS_TID_BITS != 8
+	entry->reserved = 0;
+	entry->reserved2 = 0;
+#endif
+}
+
+
+/*********************************************************************************/
+/*  void os_trace_dump()                                              *//**
+*   
+*   Writes the trace as an os_trace_header followed by the recorded entries,
+*   oldest first. tools/trace2json converts the dump to Chrome trace JSON.
+*
+*		@param writer Function writing a block of bytes to e.g. a file or a uart.
+*
+*		@return None.
+*
+*		@remarks \b Usage: @n Entries recorded while dumping may be torn, so dump
+*       when the system is stopped or from the lowest priority task.
+*
+*       @code
+static void write_file( const void *data, uint16_t size ) {
+	fwrite( data, 1, size, traceFile );
+}
+...
+os_trace_dump( write_file );
+*		@endcode
+*       
+*		 */
+/*********************************************************************************/
+void os_trace_dump( os_trace_writer writer ) {
+	os_trace_header header;
+	uint16_t head = traceHead;
+	uint16_t index;
+
+	header.magic = OS_TRACE_MAGIC;
+	header.timestampHz = os_port_timestamp_hz();
+	header.nEntries = traceFull ? OS_TRACE_ENTRIES : head;
+	header.entrySize = sizeof( os_trace_entry );
+	writer( &header, sizeof( header ) );
+
+	for ( index = head - header.nEntries; index != head; ++index ) {
+		writer( &traceBuffer[ index & ( OS_TRACE_ENTRIES - 1 ) ], sizeof( os_trace_entry ) );
+	}
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef OS_TRACE_H
+#define OS_TRACE_H
+
+/** @file os_trace.h Scheduler trace header file*/
+
+#include "os_defines.h"
+
+
+/* Trace entry types */
+#define OS_TRACE_TASK_IN		1	/* tid: task dispatched by the scheduler */
+#define OS_TRACE_TASK_OUT		2	/* tid: task returned to the scheduler */
+#define OS_TRACE_EVENT_SIGNAL	3	/* tid: signaling task, arg: event id */
+#define OS_TRACE_EVENT_WAIT		4	/* tid: waiting task, arg: event id */
+#define OS_TRACE_SEM_BLOCK		5	/* tid: blocked task, arg: semaphore address */
+#define OS_TRACE_SEM_WAKE		6	/* tid: woken task, arg: semaphore address */
+#define OS_TRACE_TICK			7
+
+
+#ifdef OS_TRACE
+
+/* Number of entries kept, the oldest entries are overwritten. Must be a power
+of two, at most 32768. */
+#ifndef OS_TRACE_ENTRIES
+#define OS_TRACE_ENTRIES	64
+#endif
+
+#if ( OS_TRACE_ENTRIES & ( OS_TRACE_ENTRIES - 1 ) ) || ( OS_TRACE_ENTRIES > 32768 )
+#error "OS_TRACE_ENTRIES must be a power of two, at most 32768"
+#endif
+
+/* One trace entry, 8 bytes, or 12 bytes with 16 bit task ids. time is in
+units of the port timestamp. */
+typedef struct {
+	uint32_t time;
+	uint8_t type;
+#if OS_TID_BITS == 8
+	os_tid_t tid;
+	uint16_t arg;
+#else
+	uint8_t reserved;
+	uint16_t arg;
+	os_tid_t tid;
+	uint16_t reserved2;
+#endif
+} os_trace_entry;
+
+/* Header written by os_trace_dump() in front of the entries */
+typedef struct {
+	uint32_t magic;
+	uint32_t timestampHz;
+	uint16_t nEntries;
+	uint16_t entrySize;
+} os_trace_header;
+
+#define OS_TRACE_MAGIC		0x54434F43u	/* "COCT" in little endian */
+
+typedef void (*os_trace_writer)( const void *data, uint16_t size );
+
+void os_trace_record( uint8_t type, os_tid_t tid, uint16_t arg );
+void os_trace_dump( os_trace_writer writer );
+
+#define OS_TRACE_RECORD( type, tid, arg )	os_trace_record( (type), (tid), (uint16_t)(arg) )
+
+#else
+
+/* The tid is only cast to void, which keeps variables set for the trace from
+being reported as unused and generates no code */
+#define OS_TRACE_RECORD( type, tid, arg )	do { (void)(tid); } while (0)
+
+#endif
+
+#endif
@@ -1 +1 @@
-#define uint8_t	U8
+#define uint8_t	U8
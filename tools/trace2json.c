@@ -0,0 +1,165 @@
+/*
+***************************************************************************************
+***************************************************************************************
+***
+***     File: trace2json.c
+***
+***     Project: cocoOS
+***
+***************************************************************************************
+***************************************************************************************
+*/
+
+/* Host tool converting a trace dumped with os_trace_dump() to the Chrome
+trace event JSON format, which Perfetto and chrome://tracing open:
+
+    gcc -O2 tools/trace2json.c -o trace2json
+    ./trace2json trace.bin > trace.json
+
+Every task gets its own track with a slice per dispatch. Events, semaphores
+and ticks show up as instant markers. The dump is little endian, as written
+by the AVR and x86 targets. Entries of 8 bytes hold 8 bit task ids, entries of
+12 bytes those of a kernel built with OS_TID_BITS 16. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Keep in sync with os_trace.h, the tool does not include the kernel headers
+so it builds on any host */
+#define OS_TRACE_MAGIC			0x54434F43u
+#define OS_TRACE_TASK_IN		1
+#define OS_TRACE_TASK_OUT		2
+#define OS_TRACE_EVENT_SIGNAL	3
+#define OS_TRACE_EVENT_WAIT		4
+#define OS_TRACE_SEM_BLOCK		5
+#define OS_TRACE_SEM_WAKE		6
+#define OS_TRACE_TICK			7
+
+#define HEADER_SIZE		12
+#define MAX_ENTRY_SIZE	12
+#define KERNEL_TRACK	100000u
+
+
+static uint32_t get32( const uint8_t *p ) {
+	return (uint32_t)p[ 0 ] | ( (uint32_t)p[ 1 ] << 8 ) | ( (uint32_t)p[ 2 ] << 16 ) | ( (uint32_t)p[ 3 ] << 24 );
+}
+
+
+static uint16_t get16( const uint8_t *p ) {
+	return (uint16_t)( p[ 0 ] | ( p[ 1 ] << 8 ) );
+}
+
+
+static int first = 1;
+
+static void event( const char *name, const char *phase, double us, unsigned track, const char *args ) {
+	printf( "%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%u%s%s}",
+		first ? "" : ",", name, phase, us, track, phase[ 0 ] == 'i' ? ",\"s\":\"t\"" : "", args );
+	first = 0;
+}
+
+
+int main( int argc, char *argv[] ) {
+	uint8_t header[ HEADER_SIZE ];
+	uint8_t entry[ MAX_ENTRY_SIZE ];
+	static uint8_t named[ 65536 ];
+	char name[ 64 ];
+	char args[ 64 ];
+	FILE *in;
+	uint32_t hz;
+	uint32_t nEntries;
+	uint16_t entrySize;
+	uint32_t noTid;
+	uint32_t i;
+	uint32_t last = 0;
+	int64_t time = 0;
+	double us;
+	uint32_t tid;
+	uint16_t arg;
+
+	if ( argc != 2 ) {
+		fprintf( stderr, "usage: %s trace.bin > trace.json\n", argv[ 0 ] );
+		return 2;
+	}
+
+	in = fopen( argv[ 1 ], "rb" );
+	if ( in == 0 ) {
+		perror( argv[ 1 ] );
+		return 1;
+	}
+
+	if ( ( fread( header, 1, HEADER_SIZE, in ) != HEADER_SIZE ) || ( get32( header ) != OS_TRACE_MAGIC ) ||
+		 ( ( get16( header + 10 ) != 8 ) && ( get16( header + 10 ) != 12 ) ) || ( get32( header + 4 ) == 0 ) ) {
+		fprintf( stderr, "%s: not a cocoOS trace dump\n", argv[ 1 ] );
+		return 1;
+	}
+	hz = get32( header + 4 );
+	nEntries = get16( header + 8 );
+	entrySize = get16( header + 10 );
+	noTid = ( entrySize == 8 ) ? 255 : 65535;
+
+	printf( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" );
+	sprintf( args, ",\"args\":{\"name\":\"kernel\"}" );
+	event( "thread_name", "M", 0, KERNEL_TRACK, args );
+
+	for ( i = 0; i != nEntries; ++i ) {
+		if ( fread( entry, 1, entrySize, in ) != entrySize ) {
+			fprintf( stderr, "%s: truncated after %" PRIu32 " entries\n", argv[ 1 ], i );
+			break;
+		}
+
+		/* Timestamps are 32 bits and wrap, accumulate the signed differences.
+		An ISR can record between the claim and the timestamp of a task, so an
+		entry may be slightly older than the one before it. */
+		if ( i != 0 ) {
+			time += (int32_t)( get32( entry ) - last );
+		}
+		last = get32( entry );
+		us = (double)time * 1e6 / hz;
+		tid = ( entrySize == 8 ) ? entry[ 5 ] : get16( entry + 8 );
+		arg = get16( entry + 6 );
+
+		if ( ( tid != noTid ) && !named[ tid ] ) {
+			named[ tid ] = 1;
+			sprintf( args, ",\"args\":{\"name\":\"task %u\"}", tid );
+			event( "thread_name", "M", 0, tid, args );
+		}
+
+		switch ( entry[ 4 ] ) {
+		case OS_TRACE_TASK_IN:
+			sprintf( name, "task %u", tid );
+			event( name, "B", us, tid, "" );
+			break;
+		case OS_TRACE_TASK_OUT:
+			sprintf( name, "task %u", tid );
+			event( name, "E", us, tid, "" );
+			break;
+		case OS_TRACE_EVENT_SIGNAL:
+			sprintf( name, "signal event %u", arg );
+			event( name, "i", us, tid == noTid ? KERNEL_TRACK : tid, "" );
+			break;
+		case OS_TRACE_EVENT_WAIT:
+			sprintf( name, "wait event %u", arg );
+			event( name, "i", us, tid, "" );
+			break;
+		case OS_TRACE_SEM_BLOCK:
+			sprintf( name, "block on sem 0x%04x", arg );
+			event( name, "i", us, tid, "" );
+			break;
+		case OS_TRACE_SEM_WAKE:
+			sprintf( name, "woken by sem 0x%04x", arg );
+			event( name, "i", us, tid, "" );
+			break;
+		case OS_TRACE_TICK:
+			event( "tick", "i", us, KERNEL_TRACK, "" );
+			break;
+		default:
+			break;
+		}
+	}
+
+	printf( "\n]}\n" );
+	fclose( in );
+	return 0;
+}